@@ -0,0 +1,149 @@
+#include "BatchSplit.h"
+#include <limits>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TSPRD_AVX2_BATCH
+#include <immintrin.h>
+#endif
+
+static bool cpuSupportsAvx2() {
+#ifdef TSPRD_AVX2_BATCH
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+static bool vectorized = cpuSupportsAvx2();
+
+bool BatchSplit::isVectorized() {
+    return vectorized;
+}
+
+void BatchSplit::setVectorized(bool v) {
+    vectorized = v && cpuSupportsAvx2();
+}
+
+void BatchSplit::split(const vector<vector<unsigned int> *> &sequences, vector<vector<unsigned int> > &ends,
+                       vector<unsigned int> &times) {
+    ends.resize(sequences.size());
+    times.resize(sequences.size());
+    if (sequences.empty()) return;
+    const unsigned int N = sequences[0]->size();
+    rd.resize((N + 1) * LANES);
+    toDepot.resize((N + 1) * LANES);
+    fromDepot.resize((N + 1) * LANES);
+    next.resize((N + 1) * LANES);
+    delta.resize((N + 1) * LANES);
+    bestIn.resize((N + 1) * LANES);
+
+    const vector<unsigned int> *group[LANES];
+    for (unsigned int first = 0; first < sequences.size(); first += LANES) {
+        // the last group is completed with copies of its last sequence
+        for (unsigned int l = 0; l < LANES; l++) {
+            group[l] = sequences[min(first + l, (unsigned int) sequences.size() - 1)];
+        }
+        splitGroup(group, N);
+
+        for (unsigned int l = 0; l < LANES && first + l < sequences.size(); l++) {
+            vector<unsigned int> &e = ends[first + l];
+            e.clear();
+            for (unsigned int x = N; x > 0; x = bestIn[x * LANES + l]) {
+                e.push_back(x - 1);
+            }
+            reverse(e.begin(), e.end());
+            times[first + l] = delta[N * LANES + l];
+        }
+    }
+}
+
+void BatchSplit::splitGroup(const vector<unsigned int> *const *group, unsigned int N) {
+    for (unsigned int k = 0; k < N; k++) {
+        for (unsigned int l = 0; l < LANES; l++) {
+            const unsigned int c = (*group[l])[k];
+            rd[k * LANES + l] = RD[c];
+            toDepot[k * LANES + l] = W[c][0];
+            fromDepot[k * LANES + l] = W[0][c];
+            next[k * LANES + l] = k + 1 < N ? W[c][(*group[l])[k + 1]] : 0;
+        }
+    }
+    for (unsigned int l = 0; l < LANES; l++) {
+        delta[l] = 0;
+    }
+
+#ifdef TSPRD_AVX2_BATCH
+    if (vectorized) return labelsAvx2(N);
+#endif
+    labelsScalar(N);
+}
+
+// the label loop of SplitEngine, lane by lane
+void BatchSplit::labelsScalar(unsigned int N) {
+    for (unsigned int l = 0; l < LANES; l++) {
+        for (unsigned int j = 1; j <= N; j++) {
+            unsigned int bigger = rd[(j - 1) * LANES + l], sumTimes = toDepot[(j - 1) * LANES + l];
+            unsigned int best = numeric_limits<unsigned int>::max(), bestI = 0;
+            for (int i = (int) j - 1; i >= 0; i--) {
+                const unsigned int k = i * LANES + l;
+                if (i < (int) j - 1) {
+                    bigger = max(bigger, rd[k]);
+                    sumTimes += next[k];
+                }
+                const unsigned int route = fromDepot[k] + sumTimes;
+                if (stopRoutes && bigger + route > best) break;
+                const unsigned int deltaJ = max(bigger, delta[k]) + route;
+                if (deltaJ <= best) {
+                    best = deltaJ;
+                    bestI = i;
+                }
+            }
+            delta[j * LANES + l] = best;
+            bestIn[j * LANES + l] = bestI;
+        }
+    }
+}
+
+#ifdef TSPRD_AVX2_BATCH
+
+/*
+ * the same loop with the 8 lanes in a vector: a lane whose routes cannot improve its label anymore is masked out,
+ * and the routes of the label are extended while any lane is active
+ * the comparisons are unsigned, a <= b when max(a, b) == b
+ */
+__attribute__((target("avx2")))
+void BatchSplit::labelsAvx2(unsigned int N) {
+    const auto *RDs = (const __m256i *) rd.data(), *TO = (const __m256i *) toDepot.data();
+    const auto *FROM = (const __m256i *) fromDepot.data(), *NEXT = (const __m256i *) next.data();
+    auto *DELTA = (__m256i *) delta.data(), *BEST_IN = (__m256i *) bestIn.data();
+    const __m256i ones = _mm256_set1_epi32(-1);
+    const __m256i stop = stopRoutes ? ones : _mm256_setzero_si256();
+
+    for (unsigned int j = 1; j <= N; j++) {
+        __m256i bigger = _mm256_loadu_si256(RDs + j - 1), sumTimes = _mm256_loadu_si256(TO + j - 1);
+        __m256i best = ones, bestI = _mm256_setzero_si256();
+        __m256i active = ones;
+        for (int i = (int) j - 1; i >= 0; i--) {
+            if (i < (int) j - 1) {
+                bigger = _mm256_max_epu32(bigger, _mm256_loadu_si256(RDs + i));
+                sumTimes = _mm256_add_epi32(sumTimes, _mm256_loadu_si256(NEXT + i));
+            }
+            const __m256i route = _mm256_add_epi32(_mm256_loadu_si256(FROM + i), sumTimes);
+            const __m256i bound = _mm256_add_epi32(bigger, route);
+            // bound <= best: the route can still improve the label
+            active = _mm256_andnot_si256(
+                    _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_max_epu32(bound, best), best), stop), active);
+            if (_mm256_testz_si256(active, active)) break;
+
+            const __m256i deltaJ = _mm256_add_epi32(_mm256_max_epu32(bigger, _mm256_loadu_si256(DELTA + i)), route);
+            const __m256i better = _mm256_and_si256(
+                    active, _mm256_cmpeq_epi32(_mm256_max_epu32(deltaJ, best), best));
+            best = _mm256_blendv_epi8(best, deltaJ, better);
+            bestI = _mm256_blendv_epi8(bestI, _mm256_set1_epi32(i), better);
+        }
+        _mm256_storeu_si256(DELTA + j, best);
+        _mm256_storeu_si256(BEST_IN + j, bestI);
+    }
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef TSPRD_BATCHSPLIT_H
+#define TSPRD_BATCHSPLIT_H
+
+#include <vector>
+#include "DistanceMatrix.h"
+
+using namespace std;
+
+/*
+ * Split of many sequences of the same size at once, as when the population is (re)initialized
+ *
+ * the sequences are taken in groups of LANES, stored position by position (the data of the k-th position of all the
+ * sequences of a group is contiguous), and the arcs, release dates and depot times are read from W once per position;
+ * the labels of the group are then computed together as in SplitEngine, each lane stopping its routes on its own
+ * the AVX2 version computes the 8 lanes in one vector, it is chosen at runtime from the cpu features
+ * each sequence gets the same routes as with Split::split
+ */
+class BatchSplit {
+public:
+    static const unsigned int LANES = 8;
+
+    BatchSplit(const DistanceMatrix &W, const vector<unsigned int> &RD, bool depotTriangular)
+            : W(W), RD(RD), stopRoutes(depotTriangular) {}
+
+    // splits the sequences, ends[k] and the returned times[k] are those of Split::split for sequences[k]
+    void split(const vector<vector<unsigned int> *> &sequences, vector<vector<unsigned int> > &ends,
+               vector<unsigned int> &times);
+
+    static bool isVectorized();
+
+    // forces the scalar version (false) or the vectorized one when the cpu supports it (true)
+    static void setVectorized(bool vectorized);
+
+private:
+    const DistanceMatrix &W;
+    const vector<unsigned int> &RD;
+    const bool stopRoutes; // as in SplitEngine
+
+    // data of the position k of the lane l at [k * LANES + l]
+    vector<unsigned int> rd; // release date of the client
+    vector<unsigned int> toDepot, fromDepot; // times from the client to the depot and from the depot to the client
+    vector<unsigned int> next; // time from the client to the next one in the sequence
+    vector<unsigned int> delta, bestIn; // label of the position and start of its last route
+
+    void splitGroup(const vector<unsigned int> *const *group, unsigned int N);
+    void labelsScalar(unsigned int N);
+    void labelsAvx2(unsigned int N);
+};
+
+#endif //TSPRD_BATCHSPLIT_H
@@ -0,0 +1,440 @@
+#include <iostream>
+#include <fstream>
+#include <regex>
+#include <chrono>
+#include <functional>
+#include <cstdlib>
+#include <new>
+#include "Instance.h"
+#include "Solution.h"
+#include "Split.h"
+#include "NeighborSearch.h"
+#include "GeneticAlgorithm.h"
+#include "RoutePool.h"
+#include "NeighborKernels.h"
+#include "Crossover.h"
+#include "BatchSplit.h"
+
+using namespace std;
+
+/*
+ * Microbenchmarks of the hot paths of the algorithm: split, nearest clients, solution construction/copy/update,
+ * each neighbor search operator, the crossover, the population distances and the route pool
+ *
+ * every benchmark runs on fixed random sequences (fixed seed) of the instances below, so two runs of the same
+ * build do the same work; the results are written in the json format of google benchmark, so the usual
+ * comparison tools can be used to spot regressions
+ * the heap allocations made by the measured code are also counted, and reported per iteration; the steps of the
+ * generation loop of the genetic algorithm must not allocate once their memory is warm, otherwise the program fails
+ * (exit code 1)
+ *
+ * usage: ./bench [--filter <regex>] [--out <file.json>] [--minTime <seconds>] [--scalar 1] [--relabel 1]
+ *   --scalar 1 disables the vectorized neighborhood kernels, batch split and distance rows
+ *   --relabel 1 loads the instances with the clients renumbered for memory locality (see Instance)
+ */
+
+static const unsigned int SEED = 12345;
+static const unsigned int POPULATION = 60; // mi + lambda of the default parameters
+static const unsigned int WARM_UP_ROUNDS = 100; // most rounds of POPULATION iterations before a steady benchmark
+
+// heap allocations made by the whole program, counted by the replaced operator new
+static unsigned long long allocations = 0;
+
+void *operator new(size_t size) {
+    allocations++;
+    void *p = malloc(size);
+    if (p == nullptr) throw bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+// measures the time of the benchmark body, which can pause the timing while preparing its data
+class State {
+    chrono::steady_clock::time_point start;
+    chrono::nanoseconds elapsed{0};
+    unsigned long long allocationsStart = 0;
+public:
+    unsigned long long iterations = 0;
+    unsigned long long items = 0; // benchmark specific work counter (moves evaluated, routes added...)
+    unsigned long long allocations = 0; // heap allocations while the timing was running
+
+    void resume() {
+        allocationsStart = ::allocations;
+        start = chrono::steady_clock::now();
+    }
+
+    void pause() {
+        elapsed += chrono::steady_clock::now() - start;
+        allocations += ::allocations - allocationsStart;
+    }
+
+    double elapsedNs() const {
+        return (double) elapsed.count();
+    }
+};
+
+struct BenchmarkResult {
+    string name;
+    unsigned int nClients;
+    unsigned long long iterations;
+    double nsPerIteration;
+    double itemsPerIteration;
+    double allocationsPerIteration;
+};
+
+class Benchmark {
+    const double minTime; // minimum measured time of each benchmark in seconds
+    const regex filter;
+    const bool relabel; // renumbers the clients of the instances
+    vector<BenchmarkResult> results;
+    bool allocated = false; // a steady benchmark allocated
+
+    // runs 'body' until it was measured for at least 'minTime'
+    // a steady benchmark is a step of the generation loop of the genetic algorithm, which must not allocate once its
+    // memory is warm: it first runs by rounds of one iteration per individual without being measured, until a round
+    // does not allocate (the vectors reached the size of the biggest solutions), then any allocation is an error
+    void run(const string &name, const Instance &instance, const function<void(State &)> &body, bool steady = false) {
+        if (!regex_search(name, filter)) return;
+
+        for (unsigned int round = 0; steady && round < WARM_UP_ROUNDS; round++) {
+            State warmUp;
+            for (; warmUp.iterations < POPULATION; warmUp.iterations++) {
+                warmUp.resume();
+                body(warmUp);
+                warmUp.pause();
+            }
+            if (warmUp.allocations == 0) break;
+        }
+
+        State state;
+        while (state.elapsedNs() < minTime * 1e9 || state.iterations < 3) {
+            state.resume();
+            body(state);
+            state.pause();
+            state.iterations++;
+        }
+
+        BenchmarkResult result = {name, instance.nClients(), state.iterations, state.elapsedNs() / state.iterations,
+                                  (double) state.items / state.iterations,
+                                  (double) state.allocations / state.iterations};
+        results.push_back(result);
+
+        char buffer[300];
+        sprintf(buffer, "%-50s %12.0f ns %10llu it %14.1f items/it %12.1f allocs/it", name.c_str(),
+                result.nsPerIteration, result.iterations, result.itemsPerIteration, result.allocationsPerIteration);
+        cout << buffer << endl;
+        if (steady && state.allocations > 0) {
+            cout << "ERROR allocations " << name << " " << state.allocations << endl;
+            allocated = true;
+        }
+    }
+
+    static vector<Sequence> randomSequences(const Instance &instance, unsigned int n, mt19937 &generator) {
+        Sequence clients(instance.nClients());
+        iota(clients.begin(), clients.end(), 1);
+        vector<Sequence> sequences(n, clients);
+        for (auto &sequence: sequences) {
+            shuffle(sequence.begin(), sequence.end(), generator);
+        }
+        return sequences;
+    }
+
+public:
+    Benchmark(double minTime, const string &filter, bool relabel)
+            : minTime(minTime), filter(filter), relabel(relabel) {}
+
+    bool hasAllocated() const {
+        return allocated;
+    }
+
+    void runInstance(const string &instanceName) {
+        Instance instance(instanceName, relabel);
+        mt19937 generator(SEED);
+        vector<Sequence> sequences = randomSequences(instance, POPULATION, generator);
+        vector<Solution *> solutions;
+        for (auto &sequence: sequences) {
+            solutions.push_back(new Solution(instance, sequence));
+        }
+        volatile unsigned int sink = 0;
+
+        run("split/" + instanceName, instance, [&](State &state) {
+            set<unsigned int> depotVisits;
+            sink = Split::split(depotVisits, instance.getW(), instance.getRD(), sequences[state.iterations % POPULATION]);
+        });
+
+        // the engine alternates between a sequence and a copy with its last quarter reversed, so it keeps the labels
+        // of the first three quarters
+        SplitEngine engine(instance.getW(), instance.getRD(), instance.isDepotTriangular());
+        Sequence changed = sequences[0];
+        reverse(changed.begin() + 3 * changed.size() / 4, changed.end());
+        vector<unsigned int> ends;
+        run("split/engineSuffix/" + instanceName, instance, [&](State &state) {
+            sink = engine.split(state.iterations % 2 ? changed : sequences[0], ends);
+        });
+
+        // the whole population split at once, as in the initialization of the genetic algorithm
+        BatchSplit batch(instance.getW(), instance.getRD(), instance.isDepotTriangular());
+        vector<Sequence *> population;
+        for (auto &sequence: sequences) {
+            population.push_back(&sequence);
+        }
+        vector<vector<unsigned int> > batchEnds;
+        vector<unsigned int> batchTimes;
+        run("split/batch/" + instanceName, instance, [&](State &state) {
+            batch.split(population, batchEnds, batchTimes);
+            sink = batchTimes[0];
+            state.items += POPULATION;
+        });
+
+        // the nearest clients of every client, as in the candidate lists of the instance
+        if (instance.hasCoordinates()) {
+            vector<unsigned int> closest;
+            run("instance/nearestClients/" + instanceName, instance, [&](State &state) {
+                for (unsigned int c = 1; c <= instance.nClients(); c++) {
+                    instance.getClientsIndex().nearest(instance.getX()[c], instance.getY()[c],
+                                                       Instance::NEAREST_CLIENTS + 1, closest);
+                    sink = closest.back();
+                }
+                state.items += instance.nClients();
+            });
+        }
+
+        run("solution/construct/" + instanceName, instance, [&](State &state) {
+            auto *s = new Solution(instance, sequences[state.iterations % POPULATION]);
+            sink = s->time;
+            delete s;
+        });
+
+        run("solution/copy/" + instanceName, instance, [&](State &state) {
+            Solution *s = solutions[state.iterations % POPULATION]->copy();
+            sink = s->time;
+            delete s;
+        });
+
+        run("solution/update/" + instanceName, instance, [&](State &state) {
+            sink = solutions[state.iterations % POPULATION]->update();
+        });
+
+        // one changed route, as after an improvement of the intra route search
+        run("solution/updateChanged/" + instanceName, instance, [&](State &state) {
+            Solution *s = solutions[state.iterations % POPULATION];
+            s->markChanged(state.iterations % s->routes.size());
+            sink = s->updateChanged();
+        });
+
+        // each operator is applied until it finds no improvement, on a fresh copy of a random solution
+        NeighborSearch ns(instance, SEED);
+        for (unsigned int op = 0; op < NeighborSearch::INTRA_OPERATORS + NeighborSearch::INTER_OPERATORS; op++) {
+            run("ns/" + string(NeighborSearch::operatorName(op)) + "/" + instanceName, instance, [&](State &state) {
+                state.pause();
+                Solution *s = solutions[state.iterations % POPULATION]->copy();
+                const unsigned long long evaluations = ns.getEvaluations();
+                state.resume();
+
+                if (op < NeighborSearch::INTRA_OPERATORS) {
+                    for (auto *route: s->routes) {
+                        sink = ns.callIntraSearch(route, op + 1);
+                    }
+                } else {
+                    sink = ns.callInterSearch(s, op - NeighborSearch::INTRA_OPERATORS + 1);
+                }
+
+                state.pause();
+                state.items += ns.getEvaluations() - evaluations;
+                delete s;
+                state.resume();
+            });
+        }
+
+        run("ns/educate/" + instanceName, instance, [&](State &state) {
+            state.pause();
+            Solution *s = solutions[state.iterations % POPULATION]->copy();
+            const unsigned long long evaluations = ns.getEvaluations();
+            state.resume();
+
+            sink = ns.educate(s);
+
+            state.pause();
+            state.items += ns.getEvaluations() - evaluations;
+            delete s;
+            state.resume();
+        });
+
+        // the local search on the giant tour alone, on a fresh copy of a random solution
+        run("ns/giantTour/" + instanceName, instance, [&](State &state) {
+            state.pause();
+            Solution *s = solutions[state.iterations % POPULATION]->copy();
+            const unsigned long long evaluations = ns.getEvaluations();
+            state.resume();
+
+            sink = ns.giantTourSearch(s);
+
+            state.pause();
+            state.items += ns.getEvaluations() - evaluations;
+            delete s;
+            state.resume();
+        });
+
+        for (auto type: {Crossover::ORDER, Crossover::CYCLIC_ORDER, Crossover::EDGE_ASSEMBLY}) {
+            Crossover crossover(instance, type);
+            Sequence child;
+            run("ga/crossover/" + string(Crossover::name(type)) + "/" + instanceName, instance, [&](State &state) {
+                const unsigned int p = state.iterations % POPULATION;
+                crossover.apply(sequences[p], sequences[(p + 1) % POPULATION], generator, child);
+                sink = child.front();
+            });
+        }
+
+        run("ga/solutionsDistances/" + instanceName, instance, [&](State &state) {
+            const unsigned int p = state.iterations % POPULATION;
+            sink = (unsigned int) (1000 * GeneticAlgorithm::solutionsDistances(
+                    solutions[p], solutions[(p + 1) % POPULATION], instance.isSymmetric()));
+        });
+
+        // a genetic algorithm stopped after its first offspring, used only to access the fitness evaluation
+        RoutePool gaPool(10000, instance.nClients());
+        Budget budget;
+        budget.maxOffspring = 1;
+        GeneticAlgorithm ga(instance, 20, 40, 6, 10, 10000, 4000, 60, budget, gaPool, SEED);
+        run("ga/getBiasedFitness/" + instanceName, instance, [&](State &) {
+            sink = (unsigned int) ga.getBiasedFitness(&solutions).front();
+        }, true);
+
+        const vector<double> fitness = ga.getBiasedFitness(&solutions);
+        run("ga/selectParents/" + instanceName, instance, [&](State &) {
+            const array<unsigned int, 2> parents = ga.selectParents(fitness);
+            sink = parents[0] + parents[1];
+        }, true);
+
+        // the offspring of a generation, from the crossover to the clone check, with the memory of the pool
+        // the crossover of each pair of parents is seeded by the pair, so the warm up makes the same offspring
+        mt19937 offspringGenerator;
+        run("ga/offspring/" + instanceName, instance, [&](State &state) {
+            const unsigned int p = state.iterations % POPULATION;
+            state.pause();
+            offspringGenerator.seed(SEED + p);
+            state.resume();
+            Sequence *child = ga.pool.acquireSequence();
+            ga.crossover.apply(sequences[p], sequences[(p + 1) % POPULATION], offspringGenerator, *child);
+            Solution *s = ga.pool.acquire(*child);
+            ga.pool.release(child);
+            sink = GeneticAlgorithm::hasClone(&solutions, s);
+            ga.pool.release(s);
+        }, true);
+
+        // the population grown to mi + lambda by copies from the pool, then reduced to mi
+        vector<Solution *> individuals;
+        run("ga/survivalSelection/" + instanceName, instance, [&](State &state) {
+            state.pause();
+            for (auto *s: individuals) ga.pool.release(s);
+            individuals.clear();
+            for (auto *s: solutions) individuals.push_back(ga.pool.acquire(s));
+            state.resume();
+
+            ga.survivalSelection(&individuals);
+            sink = individuals.front()->time;
+        }, true);
+        for (auto *s: individuals) ga.pool.release(s);
+
+        // a full cache, each store replaces the least recently used entry
+        EducationCache cache(POPULATION / 3);
+        run("ga/educationCache/" + instanceName, instance, [&](State &state) {
+            Solution *s = solutions[state.iterations % POPULATION];
+            cache.store(s->getHash(), s->getSequence(), s);
+            sink = cache.find(s);
+        }, true);
+
+        // a short run of the whole genetic algorithm, the items are the offspring generated
+        run("ga/run/" + instanceName, instance, [&](State &state) {
+            RoutePool pool(10000, instance.nClients());
+            Budget runBudget;
+            runBudget.maxOffspring = 20;
+            GeneticAlgorithm run(instance, 20, 40, 6, 10, 10000, 4000, 60, runBudget, pool, SEED);
+            sink = run.getSolution().time;
+            state.items += run.getOffspring();
+        });
+
+        // the routes of the offspring are mostly in the pool already (not a steady benchmark: the pool is an archive,
+        // it grows with the routes that its set does not recognize)
+        RoutePool knownRoutes(10000, instance.nClients());
+        for (auto *s: solutions) {
+            knownRoutes.addRoutesFrom(*s);
+        }
+        run("routePool/addKnownRoutes/" + instanceName, instance, [&](State &state) {
+            knownRoutes.addRoutesFrom(*solutions[state.iterations % POPULATION]);
+            state.items += solutions[state.iterations % POPULATION]->routes.size();
+        });
+        for (auto *route: knownRoutes.routesSet) delete route;
+
+        run("routePool/addRoutesFrom/" + instanceName, instance, [&](State &state) {
+            RoutePool pool(10000, instance.nClients());
+            for (auto *s: solutions) {
+                pool.addRoutesFrom(*s);
+            }
+            state.pause();
+            state.items += pool.routesSet.size();
+            for (auto *route: pool.routesSet) delete route;
+            state.resume();
+        });
+
+        for (auto *s: solutions) delete s;
+    }
+
+    void writeJson(const string &file) const {
+        ofstream fout(file, ios::out);
+        fout << "{" << endl;
+        fout << "  \"context\": {\"seed\": " << SEED << ", \"min_time\": " << minTime << ", \"vectorized\": "
+             << (NeighborKernels::isVectorized() ? "true" : "false") << ", \"relabel\": " << (relabel ? "true" : "false")
+             << "}," << endl;
+        fout << "  \"benchmarks\": [" << endl;
+        for (unsigned int i = 0; i < results.size(); i++) {
+            const BenchmarkResult &r = results[i];
+            fout << "    {\"name\": \"" << r.name << "\", \"n\": " << r.nClients << ", \"iterations\": "
+                 << r.iterations << ", \"real_time\": " << r.nsPerIteration << ", \"time_unit\": \"ns\""
+                 << ", \"items_per_iteration\": " << r.itemsPerIteration
+                 << ", \"allocations_per_iteration\": " << r.allocationsPerIteration << "}";
+            fout << (i + 1 < results.size() ? "," : "") << endl;
+        }
+        fout << "  ]" << endl;
+        fout << "}" << endl;
+        fout.close();
+    }
+};
+
+int main(int argc, char **argv) {
+    string filter = ".*", outFile = "output/bench.json";
+    double minTime = 0.5;
+    bool relabel = false;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--filter") filter = argv[i + 1];
+        else if (arg == "--out") outFile = argv[i + 1];
+        else if (arg == "--minTime") minTime = stod(argv[i + 1]);
+        else if (arg == "--scalar") {
+            NeighborKernels::setVectorized(stoi(argv[i + 1]) == 0);
+            BatchSplit::setVectorized(stoi(argv[i + 1]) == 0);
+            DistanceMatrix::setVectorized(stoi(argv[i + 1]) == 0);
+        } else if (arg == "--relabel") relabel = stoi(argv[i + 1]) != 0;
+    }
+
+    // instances of each set at several sizes
+    vector<string> instances({"Solomon/25/C101_1", "Solomon/100/C101_1", "TSPLIB/kroA100_1", "TSPLIB/a280_1",
+                              "aTSPLIB/ftv70_1", "aTSPLIB/rbg403_1"});
+
+    Benchmark benchmark(minTime, filter, relabel);
+    for (auto &instance: instances) {
+        benchmark.runInstance(instance);
+    }
+
+    string dir = outFile.substr(0, outFile.find_last_of('/'));
+    if (dir != outFile) system(("mkdir -p " + dir).c_str());
+    benchmark.writeJson(outFile);
+    return benchmark.hasAllocated() ? 1 : 0;
+}
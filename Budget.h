@@ -0,0 +1,18 @@
+#ifndef TSPRD_BUDGET_H
+#define TSPRD_BUDGET_H
+
+// machine independent stopping criteria, checked together with the time limit
+// a value of 0 means that the corresponding resource is not limited
+struct Budget {
+    unsigned long long maxOffspring = 0; // solutions generated (crossover in the GA, construction in the GRASP)
+    unsigned long long maxEvaluations = 0; // moves evaluated by the neighbor search
+    unsigned long long maxSplits = 0; // calls to the split algorithm
+
+    bool exhausted(unsigned long long offspring, unsigned long long evaluations, unsigned long long splits) const {
+        return (maxOffspring > 0 && offspring >= maxOffspring)
+               || (maxEvaluations > 0 && evaluations >= maxEvaluations)
+               || (maxSplits > 0 && splits >= maxSplits);
+    }
+};
+
+#endif //TSPRD_BUDGET_H
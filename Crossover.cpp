@@ -0,0 +1,176 @@
+#include <iostream>
+#include <algorithm>
+#include "Crossover.h"
+
+Crossover::Crossover(const Instance &instance, Type type)
+        : instance(instance), type(type), stamp(instance.nClients() + 1, 0) {
+    if (type == EDGE_ASSEMBLY) {
+        succ1.resize(instance.nClients() + 1);
+        pred1.resize(instance.nClients() + 1);
+        succ2.resize(instance.nClients() + 1);
+        pred2.resize(instance.nClients() + 1);
+    }
+}
+
+const char *Crossover::name(Type type) {
+    switch (type) {
+        case ORDER:
+            return "ox";
+        case CYCLIC_ORDER:
+            return "cox";
+        case EDGE_ASSEMBLY:
+            return "eax";
+    }
+    return "";
+}
+
+Crossover::Type Crossover::fromName(const string &name) {
+    for (Type type: {ORDER, CYCLIC_ORDER, EDGE_ASSEMBLY}) {
+        if (name == Crossover::name(type)) return type;
+    }
+    cout << "ERROR invalid_crossover " << name << endl;
+    exit(1);
+}
+
+void Crossover::nextStamp() {
+    currentStamp++;
+    if (currentStamp == 0) { // the stamp overflowed, the old marks must be cleared once
+        fill(stamp.begin(), stamp.end(), 0);
+        currentStamp = 1;
+    }
+}
+
+void Crossover::apply(const Sequence &parent1, const Sequence &parent2, mt19937 &generator, Sequence &offspring) {
+    nextStamp();
+    offspring.resize(parent1.size());
+    switch (type) {
+        case ORDER:
+            return order(parent1, parent2, generator, offspring);
+        case CYCLIC_ORDER:
+            return cyclicOrder(parent1, parent2, generator, offspring);
+        case EDGE_ASSEMBLY:
+            return edgeAssembly(parent1, parent2, generator, offspring);
+    }
+}
+
+void Crossover::order(const Sequence &parent1, const Sequence &parent2, mt19937 &generator, Sequence &offspring) {
+    unsigned int N = parent1.size();
+    if (N < 4) { // no segment of at least three clients that is not the whole tour
+        offspring = parent1;
+        return;
+    }
+    uniform_int_distribution<int> dist(0, (int) N - 1);
+
+    // choose radomly a sub sequence of the first parent that goes to the offspring
+    // a and b represents the start and end index of the sequence, respectively
+    unsigned int a, b;
+    do {
+        a = dist(generator);
+        b = dist(generator);
+        if (a > b) {
+            swap(a, b);
+        }
+    } while ((a == 0 && b == N - 1) || (b - a) <= 1);
+
+    // copy the chosen subsequence from the first parent to the offspring
+    for (unsigned int i = a; i <= b; i++) {
+        offspring[i] = parent1[i];
+        visit(parent1[i]);
+    }
+
+    // copy the remaining elements keeping the relative order that they appear in the second parent
+    unsigned int x = 0;
+    for (unsigned int i = 0; i < a; i++) {
+        while (visited(parent2[x])) x++; // pula os elementos que já foram copiados do primeiro pai
+        offspring[i] = parent2[x++];
+    }
+    for (unsigned int i = b + 1; i < N; i++) {
+        while (visited(parent2[x])) x++;
+        offspring[i] = parent2[x++];
+    }
+}
+
+/*
+ * the segment [a, b] of the first parent may wrap around the end of the tour, and the other clients are copied from
+ * the position b + 1 on, in the order that they appear in the second parent from the position b + 1 on
+ */
+void Crossover::cyclicOrder(const Sequence &parent1, const Sequence &parent2, mt19937 &generator,
+                            Sequence &offspring) {
+    unsigned int N = parent1.size();
+    if (N < 3) { // no segment leaves a client to the second parent
+        offspring = parent1;
+        return;
+    }
+    uniform_int_distribution<int> dist(0, (int) N - 1);
+    unsigned int a = dist(generator), b;
+    do {
+        b = dist(generator);
+    } while (b == a || (b + 1) % N == a); // at least one client of each parent
+
+    for (unsigned int i = a; i != (b + 1) % N; i = (i + 1) % N) {
+        offspring[i] = parent1[i];
+        visit(parent1[i]);
+    }
+
+    unsigned int x = (b + 1) % N;
+    for (unsigned int i = (b + 1) % N; i != a; i = (i + 1) % N) {
+        while (visited(parent2[x])) x = (x + 1) % N;
+        offspring[i] = parent2[x];
+        x = (x + 1) % N;
+    }
+}
+
+/*
+ * lightweight edge assembly: the offspring starts at the first client of the first parent and each next client is
+ * chosen among the neighbors of the current one in the tours of the parents (successors only when the instance is
+ * asymmetric), preferring the arcs of both parents and then the shorter arcs; when all the neighbors were visited,
+ * it continues with the first client of the second parent not visited yet
+ */
+void Crossover::edgeAssembly(const Sequence &parent1, const Sequence &parent2, mt19937 &generator,
+                             Sequence &offspring) {
+    const unsigned int N = parent1.size();
+    const DistanceMatrix &W = instance.getW();
+    const bool symmetric = instance.isSymmetric();
+
+    for (unsigned int i = 0; i < N; i++) {
+        succ1[parent1[i]] = i + 1 < N ? parent1[i + 1] : 0;
+        pred1[parent1[i]] = i > 0 ? parent1[i - 1] : 0;
+        succ2[parent2[i]] = i + 1 < N ? parent2[i + 1] : 0;
+        pred2[parent2[i]] = i > 0 ? parent2[i - 1] : 0;
+    }
+
+    unsigned int current = parent1[0], x = 0;
+    offspring[0] = current;
+    visit(current);
+    for (unsigned int k = 1; k < N; k++) {
+        unsigned int candidates[4] = {succ1[current], succ2[current], 0, 0};
+        if (symmetric) {
+            candidates[2] = pred1[current];
+            candidates[3] = pred2[current];
+        }
+
+        unsigned int next = 0;
+        bool nextCommon = false;
+        for (unsigned int c: candidates) {
+            if (c == 0 || visited(c)) continue;
+            // the arc (current, c) is in both parents
+            const bool common = (succ1[current] == c || (symmetric && pred1[current] == c))
+                                && (succ2[current] == c || (symmetric && pred2[current] == c));
+            if (next == 0 || (common && !nextCommon)
+                || (common == nextCommon && (W[current][c] < W[current][next]
+                                             || (W[current][c] == W[current][next] && generator() % 2)))) {
+                next = c;
+                nextCommon = common;
+            }
+        }
+
+        if (next == 0) {
+            while (visited(parent2[x])) x++;
+            next = parent2[x];
+        }
+
+        offspring[k] = next;
+        visit(next);
+        current = next;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef TSPRD_CROSSOVER_H
+#define TSPRD_CROSSOVER_H
+
+#include <vector>
+#include <string>
+#include <random>
+#include "Instance.h"
+#include "Solution.h"
+
+using namespace std;
+
+/*
+ * Crossover operators of the genetic algorithm, applied to the giant tours of the parents
+ *
+ * the offspring is written in a buffer given by the caller, and the clients already copied are marked with a stamp:
+ * each call increments the stamp instead of clearing the visited array, so a call costs O(N) with no allocation
+ * the random numbers come from the generator of the caller, so the search stays reproducible by the seed
+ */
+class Crossover {
+public:
+    enum Type {
+        ORDER, // OX: a segment of the first parent, the other clients in the order of the second parent
+        CYCLIC_ORDER, // OX where the segment can wrap around the end of the tour and the fill starts after it
+        EDGE_ASSEMBLY, // greedy assembly of the arcs of both parents, common arcs first
+    };
+
+    Crossover(const Instance &instance, Type type = ORDER);
+
+    void apply(const Sequence &parent1, const Sequence &parent2, mt19937 &generator, Sequence &offspring);
+
+    Type getType() const {
+        return type;
+    }
+
+    static const char *name(Type type);
+
+    // type given its name (ox, cox or eax), exits with an error for other names
+    static Type fromName(const string &name);
+
+private:
+    const Instance &instance;
+    const Type type;
+
+    vector<unsigned int> stamp; // stamp[c] == currentStamp: client c is already in the offspring
+    unsigned int currentStamp = 0;
+
+    // successor and predecessor of each client in the tours of the parents (0: none), used by the edge assembly
+    vector<unsigned int> succ1, pred1, succ2, pred2;
+
+    void nextStamp();
+
+    bool visited(unsigned int c) const {
+        return stamp[c] == currentStamp;
+    }
+
+    void visit(unsigned int c) {
+        stamp[c] = currentStamp;
+    }
+
+    void order(const Sequence &parent1, const Sequence &parent2, mt19937 &generator, Sequence &offspring);
+
+    void cyclicOrder(const Sequence &parent1, const Sequence &parent2, mt19937 &generator, Sequence &offspring);
+
+    void edgeAssembly(const Sequence &parent1, const Sequence &parent2, mt19937 &generator, Sequence &offspring);
+};
+
+#endif //TSPRD_CROSSOVER_H
@@ -0,0 +1,90 @@
+#include "DistanceMatrix.h"
+#include <cstring>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TSPRD_AVX2_DISTANCES
+#include <immintrin.h>
+#endif
+
+static bool cpuSupportsAvx2() {
+#ifdef TSPRD_AVX2_DISTANCES
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+static bool vectorized = cpuSupportsAvx2();
+
+bool DistanceMatrix::isVectorized() {
+    return vectorized;
+}
+
+void DistanceMatrix::setVectorized(bool v) {
+    vectorized = v && cpuSupportsAvx2();
+}
+
+#ifdef TSPRD_AVX2_DISTANCES
+
+// the same rounding as DistanceMatrix::round, the distances fit in 32 bits
+__attribute__((target("avx2")))
+static void euclideanRowAvx2(const double *X, const double *Y, unsigned int V, unsigned int i, unsigned int *row) {
+    const __m256d x = _mm256_set1_pd(X[i]), y = _mm256_set1_pd(Y[i]), half = _mm256_set1_pd(0.5);
+    unsigned int j = 0;
+    for (; j + 4 <= V; j += 4) {
+        const __m256d a = _mm256_sub_pd(x, _mm256_loadu_pd(X + j)), b = _mm256_sub_pd(y, _mm256_loadu_pd(Y + j));
+        const __m256d distance = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(a, a), _mm256_mul_pd(b, b)));
+        const __m256d rounded = _mm256_floor_pd(_mm256_add_pd(distance, half));
+        _mm_storeu_si128((__m128i *) (row + j), _mm256_cvttpd_epi32(rounded));
+    }
+    for (; j < V; j++) {
+        const double a = X[i] - X[j], b = Y[i] - Y[j];
+        row[j] = DistanceMatrix::round(sqrt(a * a + b * b));
+    }
+}
+
+#endif
+
+// rounded euclidean distances from the vertex i, the depot included
+static void euclideanRow(const double *X, const double *Y, unsigned int V, unsigned int i, unsigned int *row) {
+#ifdef TSPRD_AVX2_DISTANCES
+    if (vectorized) return euclideanRowAvx2(X, Y, V, i, row);
+#endif
+    for (unsigned int j = 0; j < V; j++) {
+        const double a = X[i] - X[j], b = Y[i] - Y[j];
+        row[j] = DistanceMatrix::round(sqrt(a * a + b * b));
+    }
+}
+
+void DistanceMatrix::row(unsigned int i, unsigned int *row) const {
+    if (isDense()) {
+        memcpy(row, data.data() + (size_t) i * V, V * sizeof(unsigned int));
+        return;
+    }
+    if (i == 0) {
+        memcpy(row, depot.data(), V * sizeof(unsigned int));
+        return;
+    }
+    euclideanRow(X.data(), Y.data(), V, i, row);
+    row[0] = depot[i];
+}
+
+// dijkstra from the depot over the rounded euclidean distances, O(V^2) with the rows computed 4 distances at a time
+void DistanceMatrix::closeDepot() {
+    depot.assign(V, numeric_limits<unsigned int>::max());
+    vector<bool> closed(V, false);
+    vector<unsigned int> distances(V);
+    depot[0] = 0;
+    for (unsigned int k = 0; k < V; k++) {
+        unsigned int u = V;
+        for (unsigned int v = 0; v < V; v++) {
+            if (!closed[v] && (u == V || depot[v] < depot[u])) u = v;
+        }
+        closed[u] = true;
+        euclideanRow(X.data(), Y.data(), V, u, distances.data());
+        for (unsigned int v = 0; v < V; v++) {
+            depot[v] = min(depot[v], depot[u] + distances[v]);
+        }
+    }
+}
@@ -0,0 +1,143 @@
+#ifndef TSPRD_DISTANCEMATRIX_H
+#define TSPRD_DISTANCEMATRIX_H
+
+#include <vector>
+#include <cmath>
+
+using namespace std;
+
+// square matrix of travel times stored in a single row-major block
+// W[i][j] reads as with a vector of vectors, but without the indirection to the row, and the whole matrix
+// is a flat array that the vectorized kernels can gather from
+//
+// for large coordinate instances the matrix is not stored (coordinate mode): W[i][j] is the rounded euclidean
+// distance of the clients, computed on each read, and flat() is null; the times from and to the depot are stored and
+// closed by shortest paths, as the floyd warshall closure of the dense matrix would do, so the triangle inequality
+// from the depot still holds (see Instance::isDepotTriangular), but the distances between clients are not closed
+class DistanceMatrix {
+    unsigned int V = 0;
+    vector<unsigned int> data; // empty in the coordinate mode
+    unsigned int *rows = nullptr; // data.data() in the dense mode, null in the coordinate mode
+    vector<double> X, Y;
+    vector<unsigned int> depot; // coordinate mode: times from the depot to each vertex, the same as to the depot
+
+    void closeDepot();
+
+public:
+    // row i of the matrix, read as a pointer to it, with a single test of the mode for each W[i][j]
+    class Row {
+        const unsigned int *rows; // null in the coordinate mode
+        size_t start; // of the row in 'rows'
+        const DistanceMatrix *matrix;
+        unsigned int i;
+
+    public:
+        Row(const DistanceMatrix *matrix, unsigned int i)
+                : rows(matrix->rows), start((size_t) i * matrix->V), matrix(matrix), i(i) {}
+
+        unsigned int operator[](unsigned int j) const {
+            if (__builtin_expect(rows != nullptr, 1)) return rows[start + j];
+            return matrix->euclidean(i, j);
+        }
+    };
+
+    // the stored matrix read without testing the mode, for the loops compiled for each mode (see NeighborSearch)
+    struct Dense {
+        const unsigned int *rows;
+        unsigned int V;
+
+        const unsigned int *operator[](unsigned int i) const {
+            return rows + (size_t) i * V;
+        }
+    };
+
+    DistanceMatrix() = default;
+
+    // 'rows' points into 'data', which keeps its buffer only when moved
+    DistanceMatrix(const DistanceMatrix &) = delete;
+
+    DistanceMatrix &operator=(const DistanceMatrix &) = delete;
+
+    DistanceMatrix(DistanceMatrix &&) = default;
+
+    DistanceMatrix &operator=(DistanceMatrix &&) = default;
+
+    void resize(unsigned int nVertex) {
+        V = nVertex;
+        data.assign((size_t) V * V, 0);
+        rows = data.data();
+        X.clear();
+        Y.clear();
+    }
+
+    // coordinate mode with the given coordinates of the vertices, O(V^2) time for the closure of the depot times
+    void setCoordinates(vector<double> x, vector<double> y) {
+        V = x.size();
+        data.clear();
+        data.shrink_to_fit();
+        rows = nullptr;
+        X = move(x);
+        Y = move(y);
+        closeDepot();
+    }
+
+    bool isDense() const {
+        return rows != nullptr;
+    }
+
+    unsigned int size() const {
+        return V;
+    }
+
+    Row operator[](unsigned int i) const {
+        return {this, i};
+    }
+
+    // only in the dense mode
+    Dense dense() const {
+        return {rows, V};
+    }
+
+    // W[0], stored in both modes
+    const unsigned int *fromDepot() const {
+        return rows != nullptr ? rows : depot.data();
+    }
+
+    // writes the matrix, only in the dense mode
+    unsigned int *operator[](unsigned int i) {
+        return rows + (size_t) i * V;
+    }
+
+    const unsigned int *flat() const {
+        return rows;
+    }
+
+    const vector<double> &getX() const {
+        return X;
+    }
+
+    const vector<double> &getY() const {
+        return Y;
+    }
+
+    static unsigned int round(double distance) {
+        return (unsigned int) floor(distance + 0.5);
+    }
+
+    // W[i][j] in the coordinate mode
+    unsigned int euclidean(unsigned int i, unsigned int j) const {
+        if (i == 0 || j == 0) return depot[i + j];
+        const double a = X[i] - X[j], b = Y[i] - Y[j];
+        return round(sqrt(a * a + b * b));
+    }
+
+    // row[j] = W[i][j] for all the vertices j, the distances of the coordinate mode are computed 4 at a time
+    void row(unsigned int i, unsigned int *row) const;
+
+    static bool isVectorized();
+
+    // forces the scalar version (false) or the vectorized one when the cpu supports it (true)
+    static void setVectorized(bool vectorized);
+};
+
+#endif //TSPRD_DISTANCEMATRIX_H
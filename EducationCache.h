@@ -0,0 +1,113 @@
+#ifndef TSPRD_EDUCATIONCACHE_H
+#define TSPRD_EDUCATIONCACHE_H
+
+#include <vector>
+#include <algorithm>
+#include "Solution.h"
+
+using namespace std;
+
+/*
+ * Bounded cache of the results of the education, keyed by the hash of the offspring right after the split
+ *
+ * late in the search the crossover often generates a child that was educated before and already left the population;
+ * the cache gives back the educated solution in O(n) instead of running the neighbor search again
+ * the giant tour of the child is stored with each entry, so a hash collision is never taken as a hit
+ * when full, the least recently used entry is replaced (found in O(capacity), negligible next to an education)
+ * the index is a sorted vector reserved for the capacity, so replacing an entry does not allocate
+ */
+class EducationCache {
+    struct Entry {
+        unsigned long long key = 0;
+        Sequence tour; // giant tour of the child before the education
+        Solution *educated = nullptr;
+        unsigned long long lastUse = 0;
+    };
+
+    const unsigned int capacity;
+    vector<Entry> entries;
+    vector<pair<unsigned long long, unsigned int> > index; // (key, position in entries), sorted by key
+    unsigned long long clock = 0;
+    unsigned long long lookups = 0, hits = 0;
+
+    // position of the key in the index, or its end
+    vector<pair<unsigned long long, unsigned int> >::iterator lookUp(unsigned long long key) {
+        auto it = lower_bound(index.begin(), index.end(), make_pair(key, 0u));
+        return it != index.end() && it->first == key ? it : index.end();
+    }
+
+public:
+    explicit EducationCache(unsigned int capacity) : capacity(capacity) {
+        entries.reserve(capacity);
+        index.reserve(capacity);
+    }
+
+    EducationCache(const EducationCache &) = delete;
+    EducationCache &operator=(const EducationCache &) = delete;
+
+    EducationCache(EducationCache &&other) noexcept
+            : capacity(other.capacity), entries(move(other.entries)), index(move(other.index)), clock(other.clock),
+              lookups(other.lookups), hits(other.hits) {
+        other.entries.clear();
+    }
+
+    // if the child (not educated yet) is in the cache, turns it in its educated solution and returns true
+    bool find(Solution *child) {
+        if (capacity == 0) return false;
+        lookups++;
+        auto it = lookUp(child->getHash());
+        if (it == index.end()) return false;
+        Entry &entry = entries[it->second];
+        if (entry.tour != child->getSequence()) return false;
+        entry.lastUse = ++clock;
+        child->mirror(entry.educated);
+        hits++;
+        return true;
+    }
+
+    // stores the result of the education of the child with the given hash and giant tour
+    void store(unsigned long long key, const Sequence &tour, Solution *educated) {
+        if (capacity == 0) return;
+        unsigned int e;
+        auto it = lookUp(key);
+        if (it != index.end()) {
+            e = it->second;
+            index.erase(it);
+        } else if (entries.size() < capacity) {
+            e = entries.size();
+            entries.emplace_back();
+        } else {
+            e = 0;
+            for (unsigned int i = 1; i < entries.size(); i++) {
+                if (entries[i].lastUse < entries[e].lastUse) e = i;
+            }
+            index.erase(lookUp(entries[e].key));
+        }
+
+        Entry &entry = entries[e];
+        entry.key = key;
+        entry.tour = tour;
+        if (entry.educated == nullptr) entry.educated = educated->copy();
+        else entry.educated->mirror(educated);
+        entry.lastUse = ++clock;
+        index.insert(lower_bound(index.begin(), index.end(), make_pair(key, 0u)), make_pair(key, e));
+    }
+
+    unsigned long long getLookups() const {
+        return lookups;
+    }
+
+    unsigned long long getHits() const {
+        return hits;
+    }
+
+    double hitRate() const {
+        return lookups == 0 ? 0 : (double) hits / lookups;
+    }
+
+    ~EducationCache() {
+        for (auto &entry: entries) delete entry.educated;
+    }
+};
+
+#endif //TSPRD_EDUCATIONCACHE_H
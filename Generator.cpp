@@ -0,0 +1,185 @@
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+
+using namespace std;
+
+/*
+ * Generator of synthetic instances of any size, for the benchmarks and the scaling studies
+ *
+ * the clients are drawn in a square whose side grows with sqrt(n), so the density of the clients (and the length of
+ * the arcs between neighbours) does not depend on n, with the depot at its center:
+ *   uniform: the clients are uniform in the square
+ *   clustered: the clients are around n / 100 centers uniform in the square (normal, clipped to the square)
+ * the release dates are uniform in [0, beta * L], where L is the length of a nearest neighbour tour of the clients,
+ * an estimate of the length of the optimal tour, so beta has about the meaning of the beta of the shipped instances
+ *
+ * the instance is written in the coordinate format (read as a TSPLIB instance) or in the matrix format (read as an
+ * aTSPLIB instance) with the rounded euclidean distances, which are not closed by floyd warshall as the coordinate
+ * instances are when they are read; the matrix file has (n + 1)^2 numbers, so it is only practical up to a few
+ * thousand clients
+ *
+ * usage: ./gen --n <clients> [--distribution uniform|clustered] [--beta <beta>] [--seed <seed>]
+ *              [--format coordinates|matrix] [--out <file>]
+ *   by default the file is instances/TSPLIB/gen_<distribution>_<n>_<beta>_<seed>.dat (instances/aTSPLIB for the
+ *   matrix format), and the name to give to the other programs is printed
+ *
+ * the generated files are not committed (see .gitignore), they are written again from their parameters: for instance
+ * TSPLIB/gen_uniform_6000_1_1, the 6000 clients used to time the coordinate mode of the education, comes from
+ *   ./gen --n 6000 --beta 1 --seed 1
+ */
+
+static unsigned int roundedDistance(const vector<double> &X, const vector<double> &Y, unsigned int i, unsigned int j) {
+    const double a = X[i] - X[j], b = Y[i] - Y[j];
+    return (unsigned int) floor(sqrt(a * a + b * b) + 0.5);
+}
+
+// length of the tour that starts at the depot and goes each time to the closest vertex not visited yet
+static unsigned long long nearestNeighbourTour(const vector<double> &X, const vector<double> &Y) {
+    const unsigned int V = X.size();
+    vector<bool> visited(V, false);
+    visited[0] = true;
+    unsigned long long length = 0;
+    unsigned int last = 0;
+    for (unsigned int k = 1; k < V; k++) {
+        unsigned int next = 0, nextDistance = 0;
+        for (unsigned int v = 1; v < V; v++) {
+            if (visited[v]) continue;
+            const unsigned int distance = roundedDistance(X, Y, last, v);
+            if (next == 0 || distance < nextDistance) {
+                next = v;
+                nextDistance = distance;
+            }
+        }
+        visited[next] = true;
+        length += nextDistance;
+        last = next;
+    }
+    return length + roundedDistance(X, Y, last, 0);
+}
+
+static void writeCoordinates(ofstream &out, const vector<double> &X, const vector<double> &Y,
+                             const vector<unsigned int> &RD) {
+    const unsigned int V = X.size();
+    unsigned int horizon = 0;
+    for (unsigned int v = 0; v < V; v++) {
+        horizon = max(horizon, RD[v]);
+    }
+    out << "<DIMENSION> " << V << "\n";
+    out << "<VEHICLE_CAPACITY>\t100\n";
+    out << "<NUMBER_OF_VEHICLES>\t" << V << "\n";
+    out << "<TIME_HORIZON>\t" << horizon << "\n";
+    out << "<VERTICES> XCOORD - YCOORD - DEMAND - OPENING_TW - CLOSING_TW - SERVICE_TIME - RELEASE DATE </VERTICES>\n";
+    for (unsigned int v = 0; v < V; v++) {
+        out << X[v] << "\t" << Y[v] << "\t 0\t 0\t 0\t 0\t " << RD[v] << "\n";
+    }
+}
+
+static void writeMatrix(ofstream &out, const string &name, const vector<double> &X, const vector<double> &Y,
+                        const vector<unsigned int> &RD) {
+    const unsigned int V = X.size();
+    out << "NAME: " << name << "\n";
+    out << "TYPE: ATSP\n";
+    out << "COMMENT: rounded euclidean distances of generated clients\n";
+    out << "DIMENSION: " << V << "\n";
+    out << "EDGE_WEIGHT_TYPE: EXPLICIT\n";
+    out << "EDGE_WEIGHT_FORMAT: FULL_MATRIX\n";
+    out << "EDGE_WEIGHT_SECTION\n";
+    for (unsigned int i = 0; i < V; i++) {
+        for (unsigned int j = 0; j < V; j++) {
+            out << roundedDistance(X, Y, i, j) << (j + 1 < V ? " " : "\n");
+        }
+    }
+    out << "RELEASE_DATES\n";
+    for (unsigned int v = 0; v < V; v++) {
+        out << RD[v] << "\n";
+    }
+    out << "EOF\n";
+}
+
+int main(int argc, char **argv) {
+    unsigned int n = 0, seed = 1;
+    string distribution = "uniform", format = "coordinates", outFile;
+    double beta = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--n") n = stoul(argv[i + 1]);
+        else if (arg == "--distribution") distribution = argv[i + 1];
+        else if (arg == "--beta") beta = stod(argv[i + 1]);
+        else if (arg == "--seed") seed = stoul(argv[i + 1]);
+        else if (arg == "--format") format = argv[i + 1];
+        else if (arg == "--out") outFile = argv[i + 1];
+    }
+    if (n == 0 || (distribution != "uniform" && distribution != "clustered") ||
+        (format != "coordinates" && format != "matrix") || beta < 0) {
+        cout << "ERROR invalid_arguments" << endl;
+        cout << "usage: ./gen --n <clients> [--distribution uniform|clustered] [--beta <beta>] [--seed <seed>] "
+                "[--format coordinates|matrix] [--out <file>]" << endl;
+        exit(1);
+    }
+
+    ostringstream betaName;
+    betaName << beta;
+    const string name = "gen_" + distribution + "_" + to_string(n) + "_" + betaName.str() + "_" + to_string(seed);
+    const string set = format == "coordinates" ? "TSPLIB" : "aTSPLIB";
+    const bool defaultFile = outFile.empty();
+    if (defaultFile) {
+        system(("mkdir -p instances/" + set).c_str());
+        outFile = "instances/" + set + "/" + name + ".dat";
+    }
+
+    mt19937 generator(seed);
+    const double side = round(100 * sqrt((double) n));
+    uniform_real_distribution<double> inSquare(0, side);
+    const unsigned int V = n + 1;
+    vector<double> X(V), Y(V);
+    X[0] = Y[0] = round(side / 2);
+    if (distribution == "uniform") {
+        for (unsigned int v = 1; v < V; v++) {
+            X[v] = round(inSquare(generator));
+            Y[v] = round(inSquare(generator));
+        }
+    } else {
+        const unsigned int nCenters = max(1u, n / 100);
+        vector<double> centerX(nCenters), centerY(nCenters);
+        for (unsigned int c = 0; c < nCenters; c++) {
+            centerX[c] = inSquare(generator);
+            centerY[c] = inSquare(generator);
+        }
+        // the clusters spread over about a tenth of the distance between the centers
+        normal_distribution<double> aroundCenter(0, side / sqrt((double) nCenters) / 10);
+        uniform_int_distribution<unsigned int> anyCenter(0, nCenters - 1);
+        for (unsigned int v = 1; v < V; v++) {
+            const unsigned int c = anyCenter(generator);
+            X[v] = round(min(max(centerX[c] + aroundCenter(generator), 0.0), side));
+            Y[v] = round(min(max(centerY[c] + aroundCenter(generator), 0.0), side));
+        }
+    }
+
+    const unsigned long long tour = nearestNeighbourTour(X, Y);
+    uniform_int_distribution<unsigned int> releaseDate(0, (unsigned int) (beta * tour));
+    vector<unsigned int> RD(V, 0);
+    for (unsigned int v = 1; v < V; v++) {
+        RD[v] = releaseDate(generator);
+    }
+
+    ofstream out(outFile.c_str(), ios::out);
+    if (!out) {
+        cout << "ERROR failed_open_file" << endl;
+        exit(1);
+    }
+    out << fixed << setprecision(0);
+    if (format == "coordinates") writeCoordinates(out, X, Y, RD);
+    else writeMatrix(out, name, X, Y, RD);
+    out.close();
+
+    if (defaultFile) cout << "INSTANCE " << set << "/" << name << " ";
+    cout << "FILE " << outFile << " TOUR " << tour << endl;
+    return 0;
+}
@@ -1,35 +1,31 @@
 #include <chrono>
 #include <random>
-#include <queue>
 #include <algorithm>
 #include "GeneticAlgorithm.h"
 
-void freePopulation(vector<Sequence *> *population) {
-    for (auto p: *population) {
-        delete p;
-    }
-    population->clear();
-}
-
 GeneticAlgorithm::GeneticAlgorithm(
         const Instance &instance, unsigned int mi, unsigned int lambda, unsigned int nClose, unsigned int nbElite,
-        unsigned int itNi, unsigned int itDiv, unsigned int timeLimit, RoutePool &routePool
+        unsigned int itNi, unsigned int itDiv, unsigned int timeLimit, const Budget &budget, RoutePool &routePool,
+        unsigned int seed, const SearchOptions &searchOptions, Crossover::Type crossoverType
 ) : instance(instance), mi(mi), lambda(lambda), nbElite(nbElite), nClose(nClose), itNi(itNi), itDiv(itDiv),
-    timeLimit(timeLimit), ns(instance), endTime(0), bestSolutionFoundTime(0), generator((random_device()) ()),
+    timeLimit(timeLimit), budget(budget), lowerBound(LowerBound(instance).value()), pool(instance),
+    crossover(instance, crossoverType), educationCache(EDUCATION_CACHE_SIZE),
+    batchSplit(instance.getW(), instance.getRD(), instance.isDepotTriangular()),
+    ns(instance, seed, true, searchOptions), endTime(0),
+    bestSolutionFoundTime(0),
+    generator(Random::derive(seed, Random::GENETIC_ALGORITHM)),
     distPopulation(0, (int) mi - 1), routePool(routePool) {
 
     milliseconds maxTime(this->timeLimit * 1000);
     timer.start();
 
-    vector<Sequence *> *population = initializePopulation();
     // represents the population for the genetic algorithm
-    // the population is simple the big tours (tours sequence) ignoring visits to the depot
-    vector<Solution *> *solutions = Solution::solutionsFromSequences(instance, population);
-    // represents the solution itself, with a set of routes
-    // during the genetic algorithm execution, we frequently transforms the population in solutions
-    // applying the split algorithm which find the optimal depot visits for each sequence;
-    // and we transform the solutions in a population, removing the depot visits from the solutions
-    // and constructing a vector with only the clients visit sequence
+    // each individual has its routes and its big tour (the clients sequence ignoring the visits to the depot),
+    // the crossover works on the big tours and the split algorithm finds the optimal depot visits of the offspring
+    // the big tour of an individual is rebuilt from its routes only when the education changed them
+    auto *solutions = new vector<Solution *>();
+    solutions->reserve(mi + lambda);
+    initializePopulation(solutions);
 
     // get best solution in inicial population
     bestSolution = nullptr;
@@ -43,27 +39,43 @@ GeneticAlgorithm::GeneticAlgorithm(
 
     unsigned int iterations_not_improved = 0;
 
-    while (iterations_not_improved < this->itNi && timer.elapsedTime() < maxTime) {
-        vector<double> biasedFitness = getBiasedFitness(solutions);
+    // the search also stops when the best solution is optimal, its time being the lower bound
+    while (iterations_not_improved < this->itNi && timer.elapsedTime() < maxTime && !budgetExhausted()
+           && bestSolution->time > lowerBound) {
+        // kept apart, the diversification computes the fitness of the population again during the generation
+        generationFitness = getBiasedFitness(solutions);
 
         while (solutions->size() < mi + lambda) {
             // SELECAO DOS PARENTES PARA CROSSOVER
-            vector<unsigned int> p = selectParents(biasedFitness);
+            const array<unsigned int, 2> p = selectParents(generationFitness);
 
-            Sequence *child = GeneticAlgorithm::orderCrossover(*population->at(p[0]), *population->at(p[1]));
-            auto *sol = new Solution(instance, *child);
-            delete child;
+            Sequence *child = pool.acquireSequence();
+            crossover.apply(solutions->at(p[0])->getSequence(), solutions->at(p[1])->getSequence(), generator, *child);
+            Solution *sol = pool.acquire(*child);
+            pool.release(child);
+            offspring++;
+            splits++;
 
             // EDUCACAO
-            ns.educate(sol);
-            solutions->push_back(sol);
-
-            routePool.addRoutesFrom(*sol);
+            // a child equal to an individual of the population was educated already, and would be removed as a clone
+            const bool duplicate = hasClone(solutions, sol);
+            if (duplicate) {
+                duplicates++;
+                pool.release(sol);
+            } else {
+                if (!educationCache.find(sol)) {
+                    const unsigned long long key = sol->getHash();
+                    childTour = sol->getSequence();
+                    ns.educate(sol);
+                    educationCache.store(key, childTour, sol);
+                }
+                solutions->push_back(sol);
+                routePool.addRoutesFrom(*sol);
+            }
 
-            if (sol->time < bestSolution->time) {
+            if (!duplicate && sol->time < bestSolution->time) {
                 bestSolutionFoundTime = timer.elapsedTime();
-                delete bestSolution;
-                bestSolution = sol->copy();
+                bestSolution->mirror(sol);
                 // cout << "Best Solution Found: " << bestSolution->time << endl;
                 searchProgress.emplace_back(bestSolutionFoundTime.count(), bestSolution->time);
 
@@ -76,38 +88,35 @@ GeneticAlgorithm::GeneticAlgorithm(
                     break;
                 }
             }
-            if (timer.elapsedTime() > maxTime) break; // time limit
+            // time limit, budget or optimal solution
+            if (timer.elapsedTime() > maxTime || budgetExhausted() || bestSolution->time <= lowerBound) break;
         }
 
         survivalSelection(solutions);
-
-        //recalculate population
-        freePopulation(population);
-        for (Solution *s: *solutions) {
-            population->push_back(s->toSequence());
-        }
     }
 
     endTime = timer.elapsedTime();
-}
-
-vector<Sequence *> *GeneticAlgorithm::initializePopulation() {
-    // initial population will be of size 2*mi generated randomly
-    vector<unsigned int> clients(instance.nClients()); // represents the sequence of clients visiting (big tour)
-    // will be shuffled for each element of the population
-    iota(clients.begin(), clients.end(), 1);
 
-    auto pop = new vector<Sequence *>(mi + lambda);
-    pop->resize(2 * mi);
-    // reduces the size of the vector, but keeps enough space to store the max population without needing reallocation
+    for (auto *s: *solutions) pool.release(s);
+    delete solutions;
+}
 
-    for (unsigned int i = 0; i < 2 * mi; i++) {
-        auto sequence = new Sequence(clients);
+void GeneticAlgorithm::initializePopulation(vector<Solution *> *solutions) {
+    // appends 2*mi solutions generated randomly
+    newSequences.resize(2 * mi);
+    for (auto &sequence: newSequences) {
+        sequence = pool.acquireSequence(); // represents the sequence of clients visiting (big tour)
+        sequence->resize(instance.nClients());
+        iota(sequence->begin(), sequence->end(), 1);
         shuffle(sequence->begin(), sequence->end(), generator);
-        pop->at(i) = sequence;
     }
 
-    return pop;
+    batchSplit.split(newSequences, newEnds, newTimes);
+    for (unsigned int i = 0; i < newSequences.size(); i++) {
+        solutions->push_back(pool.acquire(*newSequences[i], newEnds[i]));
+        pool.release(newSequences[i]);
+        splits++;
+    }
 }
 
 /**
@@ -123,14 +132,19 @@ double GeneticAlgorithm::solutionsDistances(Solution *s1, Solution *s2, bool sym
     unsigned int I = 0; // number of arcs that exists in both solutions
     unsigned int U = 0; // number of arcs in Arcs(s1) U Arcs(s2)
 
-    vector<set<unsigned int> > adjList1(V);
+    // the arcs of s1 are given by the vertex before and after each client, the depot is the only repeated vertex
+    static thread_local vector<unsigned int> succ1, pred1;
+    succ1.resize(V);
+    pred1.resize(V);
+    bool emptyRoute = false; // the arc (0, 0)
     for (auto &route: s1->routes) {
+        if (route->size() == 2) emptyRoute = true;
         for (unsigned int c = 1; c < route->size(); c++) {
             U++; // count arcs in s1
             a = route->at(c - 1);
             b = route->at(c);
-            adjList1[a].insert(b);
-            if (symmetric) adjList1[b].insert(a);
+            if (a != 0) succ1[a] = b;
+            if (b != 0) pred1[b] = a;
         }
     }
 
@@ -138,7 +152,12 @@ double GeneticAlgorithm::solutionsDistances(Solution *s1, Solution *s2, bool sym
         for (unsigned int c = 1; c < route->size(); c++) {
             a = route->at(c - 1);
             b = route->at(c);
-            if (adjList1[a].find(b) != adjList1[a].end()) {
+            bool common;
+            if (a != 0) common = succ1[a] == b || (symmetric && pred1[a] == b);
+            else if (b != 0) common = pred1[b] == 0 || (symmetric && succ1[b] == 0);
+            else common = emptyRoute;
+
+            if (common) {
                 I++;
             } else {
                 U++;
@@ -151,69 +170,53 @@ double GeneticAlgorithm::solutionsDistances(Solution *s1, Solution *s2, bool sym
 
 /**
  *
- * @param d matrix of the distances of the solutions
+ * @param di distances of the solution i to the n solutions
  * @param n_close how many closest solutions should the algorithm consider to calculate the mean
  * @param i which solution to calculate the mean
+ * @param closest scratch for the distances to the other solutions
  * @return the mean of the distances of the solution i to the 'nClose' closest solutions
  */
-double nCloseMean(const vector<vector<double> > &d, unsigned int n_close, unsigned int i) {
-    const vector<double> &di = d[i];
-    // criamos uma fila de prioridade para armazenar as n_close menores distancias
-    priority_queue<double> pq;
-    // insere as distancias dos primeiros n_close clientes
-    unsigned int j;
-    for (j = 0; pq.size() < n_close; j++) {
-        if (i == j)
-            continue;
-        pq.push(di[j]);
-    }
-
-    // para cada distancia restante verifica se eh menor que alguma anterior
-    for (; j < d.size(); j++) {
-        if (i == j)
-            continue;
-
-        double dij = di[j];
-        if (dij < pq.top()) {
-            pq.pop();
-            pq.push(dij);
-        }
+double nCloseMean(const double *di, unsigned int n, unsigned int n_close, unsigned int i, vector<double> &closest) {
+    closest.clear();
+    for (unsigned int j = 0; j < n; j++) {
+        if (i != j) closest.push_back(di[j]);
     }
+    n_close = min(n_close, (unsigned int) closest.size());
+    partial_sort(closest.begin(), closest.begin() + n_close, closest.end());
 
-    // calcula a media das menores distancias;
+    // calcula a media das menores distancias, da maior para a menor
     double sum = 0;
-    for (j = 0; j < n_close; j++) {
-        sum += pq.top();
-        pq.pop();
+    for (unsigned int j = n_close; j > 0; j--) {
+        sum += closest[j - 1];
     }
 
     return sum / n_close;
 }
 
-vector<double> GeneticAlgorithm::getBiasedFitness(vector<Solution *> *solutions) const {
+const vector<double> &GeneticAlgorithm::getBiasedFitness(vector<Solution *> *solutions) {
     unsigned int N = solutions->size(); // nbIndiv
-    vector<double> biasedFitness(N);
 
-    vector<vector<double> > d(N, vector<double>(N)); // guarda a distancia entre cada par de cromossomo
+    distances.resize(N * N); // guarda a distancia entre cada par de cromossomo, linha a linha
     for (unsigned int i = 0; i < N; i++) {
+        distances[i * N + i] = 0;
         for (unsigned int j = i + 1; j < N; j++) {
-            d[i][j] = solutionsDistances(solutions->at(i), solutions->at(j), instance.isSymmetric());
-            d[j][i] = d[i][j];
+            distances[i * N + j] = solutionsDistances(solutions->at(i), solutions->at(j), instance.isSymmetric());
+            distances[j * N + i] = distances[i * N + j];
         }
     }
 
-    vector<double> nMean(N);
+    nMean.resize(N);
     for (unsigned int i = 0; i < N; i++) {
-        nMean[i] = nCloseMean(d, nClose, i);
+        nMean[i] = nCloseMean(distances.data() + i * N, N, nClose, i, closest);
     }
 
-    vector<unsigned int> sortedIndex(N);
+    sortedIndex.resize(N);
     iota(sortedIndex.begin(), sortedIndex.end(), 0);
-    sort(sortedIndex.begin(), sortedIndex.end(), [&nMean](int i, int j) {
+    sort(sortedIndex.begin(), sortedIndex.end(), [this](int i, int j) {
         return nMean[i] > nMean[j];
     });
 
-    vector<unsigned int> rankDiversity(N); // rank of the solution with respect to the diversity contribution
+    rankDiversity.resize(N); // rank of the solution with respect to the diversity contribution
     // best solutions (higher nMean distance) have the smaller ranks
     for (unsigned int i = 0; i < rankDiversity.size(); i++) {
         rankDiversity[sortedIndex[i]] = i + 1;
@@ -224,14 +227,14 @@ vector<double> GeneticAlgorithm::getBiasedFitness(vector<Solution *> *solutions)
     sort(sortedIndex.begin(), sortedIndex.end(), [&solutions](int i, int j) {
         return solutions->at(i)->time < solutions->at(j)->time;
     });
-    vector<unsigned int> rankFitness(N);
+    rankFitness.resize(N);
     for (unsigned int i = 0; i < rankFitness.size(); i++) {
         rankFitness[sortedIndex[i]] = i + 1;
     }
 
     // calculate the biased fitness with the equation 4 of the vidal article
     // best solutions have smaller biased fitness
-    biasedFitness.resize(solutions->size());
+    biasedFitness.resize(N);
     for (unsigned int i = 0; i < biasedFitness.size(); i++) {
         biasedFitness[i] = rankFitness[i] + (1 - ((double) nbElite / N)) * rankDiversity[i];
     }
@@ -239,12 +242,12 @@ vector<double> GeneticAlgorithm::getBiasedFitness(vector<Solution *> *solutions)
     return biasedFitness;
 }
 
-vector<unsigned int> GeneticAlgorithm::selectParents(vector<double> &biasedFitness) {
+array<unsigned int, 2> GeneticAlgorithm::selectParents(const vector<double> &fitness) {
     // select first parent
-    vector<unsigned int> p(2);
+    array<unsigned int, 2> p{};
     int p1a = distPopulation(generator), p1b = distPopulation(generator);
     p[0] = p1a;
-    if (biasedFitness[p1b] < biasedFitness[p1a])
+    if (fitness[p1b] < fitness[p1a])
         p[0] = p1b;
 
 
@@ -252,105 +255,74 @@ vector<unsigned int> GeneticAlgorithm::selectParents(vector<double> &biasedFitne
     do {
         int p2a = distPopulation(generator), p2b = distPopulation(generator);
         p[1] = p2a;
-        if (biasedFitness[p2b] < biasedFitness[p2a])
+        if (fitness[p2b] < fitness[p2a])
             p[1] = p2b;
     } while (p[0] == p[1]);
 
     return p;
 }
 
-Sequence *GeneticAlgorithm::orderCrossover(const Sequence &parent1, const Sequence &parent2) {
-    static random_device rd;
-    static mt19937 generator(rd());
-
-    unsigned int N = parent1.size();
-    uniform_int_distribution<int> dist(0, (int) N - 1);
-
-    // choose radomly a sub sequence of the first parent that goes to the offspring
-    // a and b represents the start and end index of the sequence, respectively
-    unsigned int a, b;
-    do {
-        a = dist(generator);
-        b = dist(generator);
-        if (a > b) {
-            swap(a, b);
-        }
-    } while ((a == 0 && b == N - 1) || (b - a) <= 1);
-
-    // copy the chosen subsequence from the first parent to the offspring
-    vector<bool> has(N, false);
-    auto *offspring = new vector<unsigned int>(N);
-    for (unsigned int i = a; i <= b; i++) {
-        offspring->at(i) = parent1[i];
-        has[offspring->at(i)] = true;
-    }
-
-    // copy the remaining elements keeping the relative order that they appear in the second parent
-    int x = 0;
-    for (unsigned int i = 0; i < a; i++) {
-        while (has[parent2[x]]) // pula os elementos que já foram copiados do primeiro pai
-            x++;
-
-        offspring->at(i) = parent2[x];
-        x++;
-    }
-    for (unsigned int i = b + 1; i < N; i++) {
-        while (has[parent2[x]]) // pula os elementos que já foram copiados do primeiro pai
-            x++;
-
-        offspring->at(i) = parent2[x];
-        x++;
-    }
-
-    return offspring;
-}
-
 void GeneticAlgorithm::survivalSelection(vector<Solution *> *solutions, unsigned int Mi) {
-    vector<double> biasedFitness = getBiasedFitness(solutions);
+    getBiasedFitness(solutions);
     for (unsigned int i = 0; i < solutions->size(); i++) {
         solutions->at(i)->id = i;
     }
 
     // look for clones and give them a very low biased fitness
     // this way they will be removed from population
+    // a clone has the hash of the first solution equal to it, the full comparison runs only on equal hashes
+    // the first solution with each hash is the first one of its hash once the pairs (hash, position) are sorted
     const double INF = instance.nVertex() * 10;
-    vector<bool> isClone(solutions->size(), false);
-    for (unsigned int i = 0; i < solutions->size(); i++) {
-        if (isClone[i]) continue;
-        for (unsigned int j = i + 1; j < solutions->size(); j++) {
-            if (solutions->at(i)->equals(solutions->at(j))) {
-                isClone[j] = true;
-                biasedFitness[j] += INF;
+    isClone.assign(solutions->size(), false);
+    hashes.clear();
+    for (unsigned int j = 0; j < solutions->size(); j++) {
+        hashes.emplace_back(solutions->at(j)->getHash(), j);
+    }
+    sort(hashes.begin(), hashes.end());
+    for (unsigned int j = 0; j < solutions->size(); j++) {
+        Solution *s = solutions->at(j);
+        const unsigned int first = lower_bound(hashes.begin(), hashes.end(), make_pair(s->getHash(), 0u))->second;
+        if (first == j) continue; // the first solution with this hash
+        if (solutions->at(first)->equals(s)) {
+            isClone[j] = true;
+        } else { // two different solutions with the same hash
+            for (unsigned int i = 0; i < j && !isClone[j]; i++) {
+                isClone[j] = !isClone[i] && solutions->at(i)->equals(s);
             }
         }
+        if (isClone[j]) biasedFitness[j] += INF;
     }
 
     // sort the solutions based on the biased fitness and keep only the best 'mi' solutions
-    sort(solutions->begin(), solutions->end(), [&biasedFitness](Solution *s1, Solution *s2) {
+    sort(solutions->begin(), solutions->end(), [this](Solution *s1, Solution *s2) {
         return biasedFitness[s1->id] < biasedFitness[s2->id];
     });
-    for (unsigned int c = Mi + 1; c < solutions->size(); c++) {
-        delete solutions->at(c);
+    for (unsigned int c = Mi; c < solutions->size(); c++) {
+        pool.release(solutions->at(c));
     }
     solutions->resize(Mi);
 }
 
+bool GeneticAlgorithm::hasClone(vector<Solution *> *solutions, Solution *s) {
+    for (Solution *other: *solutions) {
+        if (other->getHash() == s->getHash() && other->equals(s)) return true;
+    }
+    return false;
+}
+
 void GeneticAlgorithm::diversify(vector<Solution *> *solutions) {
     survivalSelection(solutions, mi / 3); // keeps the mi/3 best solutions we have so far
 
     // generate more solutions with the same procedure that generated the initial population
     // and appends to the current solutions
-    vector<Sequence *> *population = initializePopulation();
+    const unsigned int first = solutions->size();
+    initializePopulation(solutions);
 
-    for (auto *sequence: *population) {
-        auto *s = new Solution(instance, *sequence);
+    for (unsigned int i = first; i < solutions->size(); i++) {
+        Solution *s = solutions->at(i);
         if (s->time < this->bestSolution->time) {
-            delete this->bestSolution;
-            this->bestSolution = s->copy();
+            this->bestSolution->mirror(s);
             searchProgress.emplace_back(timer.elapsedTime().count(), s->time);
         }
-        solutions->push_back(s);
-        delete sequence;
     }
-    delete population;
 }
\ No newline at end of file
@@ -3,14 +3,23 @@
 
 
 #include <chrono>
+#include <array>
 #include "Instance.h"
 #include "NeighborSearch.h"
 #include "Timer.h"
 #include "RoutePool.h"
+#include "Random.h"
+#include "Budget.h"
+#include "LowerBound.h"
+#include "SolutionPool.h"
+#include "Crossover.h"
+#include "EducationCache.h"
+#include "BatchSplit.h"
 
 using namespace chrono;
 
 class GeneticAlgorithm {
+    friend class Benchmark;
 private:
     const Instance &instance;
     const unsigned int mi; // minimum size of the population
@@ -21,6 +30,20 @@ private:
     const unsigned int itNi; // max number of iterations without improvement to stop the algorithm
     const unsigned int itDiv; // max number of iterations without improvement to diversify the current population
     const unsigned int timeLimit; // time limit of the execution of the algorithm in seconds
+    const Budget budget; // machine independent limits of the execution
+    const unsigned int lowerBound; // the search stops when the best solution reaches it, see LowerBound
+
+    SolutionPool pool; // memory of the discarded individuals, reused by the new ones
+    Crossover crossover;
+
+    static const unsigned int EDUCATION_CACHE_SIZE = 1000; // 0 disables the cache
+    EducationCache educationCache; // educated offspring, reused when the crossover generates the same child again
+    Sequence childTour; // giant tour of the offspring before the education
+
+    BatchSplit batchSplit; // splits the random sequences of the (re)initialization of the population together
+    vector<Sequence *> newSequences;
+    vector<vector<unsigned int> > newEnds;
+    vector<unsigned int> newTimes;
 
     NeighborSearch ns;
     Solution *bestSolution;
@@ -31,34 +54,53 @@ private:
 
     vector<pair<unsigned int, unsigned int> > searchProgress; // stores (time, value) of each best solution found
 
+    unsigned long long offspring = 0; // number of offspring generated by crossover
+    unsigned long long splits = 0; // calls to the split algorithm made outside the neighbor search
+    unsigned long long duplicates = 0; // offspring discarded before the education, equal to an individual
+
     RoutePool &routePool;
 
     // random number generator
     mt19937 generator;
     uniform_int_distribution<int> distPopulation; // distribution for the population [0, mi)
 
-    vector<Sequence *> *initializePopulation();
+    void initializePopulation(vector<Solution *> *solutions);
 
-    vector<double> getBiasedFitness(vector<Solution *> *solutions) const;
+    // scratch of the fitness and of the survival selection, reused by all the generations
+    vector<double> distances; // distances[i * N + j]: distance between the solutions i and j of the population
+    vector<double> closest, nMean, biasedFitness;
+    vector<unsigned int> sortedIndex, rankDiversity, rankFitness;
+    vector<double> generationFitness; // fitness of the population at the start of the generation
+    vector<bool> isClone;
+    vector<pair<unsigned long long, unsigned int> > hashes; // (hash, position) of the solutions, sorted
 
-    vector<unsigned int> selectParents(vector<double> &biasedFitness);
+    // biased fitness of each solution, valid until the next call
+    const vector<double> &getBiasedFitness(vector<Solution *> *solutions);
 
-    static double solutionsDistances(Solution *s1, Solution *s2, bool symmetric);
+    array<unsigned int, 2> selectParents(const vector<double> &fitness);
 
-    static Sequence *orderCrossover(const Sequence &parent1, const Sequence &parent2);
+    static double solutionsDistances(Solution *s1, Solution *s2, bool symmetric);
 
     void survivalSelection(vector<Solution *> *solutions, unsigned int Mi);
 
+    static bool hasClone(vector<Solution *> *solutions, Solution *s);
+
     void survivalSelection(vector<Solution *> *solutions) { // default mi
         return survivalSelection(solutions, this->mi);
     }
 
     void diversify(vector<Solution *> *solutions);
 
+    bool budgetExhausted() const {
+        return budget.exhausted(offspring, ns.getEvaluations(), splits + ns.getSplits());
+    }
+
 public:
     GeneticAlgorithm(const Instance &instance, unsigned int mi, unsigned int lambda, unsigned int nClose,
                      unsigned int nbElite, unsigned int itNi, unsigned int itDiv, unsigned int timeLimit,
-                     RoutePool &routePool);
+                     const Budget &budget, RoutePool &routePool, unsigned int seed,
+                     const SearchOptions &searchOptions = SearchOptions(),
+                     Crossover::Type crossoverType = Crossover::ORDER);
 
     const Solution &getSolution() {
         return *bestSolution;
@@ -75,6 +117,34 @@ public:
     const vector<pair<unsigned int, unsigned int> > &getSearchProgress() {
         return searchProgress;
     }
+
+    unsigned int getLowerBound() const {
+        return lowerBound;
+    }
+
+    unsigned long long getOffspring() const {
+        return offspring;
+    }
+
+    unsigned long long getEvaluations() const {
+        return ns.getEvaluations();
+    }
+
+    unsigned long long getDuplicates() const {
+        return duplicates;
+    }
+
+    const EducationCache &getEducationCache() const {
+        return educationCache;
+    }
+
+    unsigned long long getSplits() const {
+        return splits + ns.getSplits();
+    }
+
+    const NeighborSearch &getNeighborSearch() const {
+        return ns;
+    }
 };
 
 
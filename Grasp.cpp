@@ -3,24 +3,27 @@
 #include <random>
 #include <algorithm>
 #include "Grasp.h"
-#include "NeighborSearch.h"
 
 #define F(R) 1 // index of first client in a route
 #define L(R) ((R).size() - 2) // index of last client in a route
 
 Grasp::Grasp(
-        const Instance &instance, unsigned int itNi, double alpha, unsigned int timeLimit
+        const Instance &instance, unsigned int itNi, double alpha, unsigned int timeLimit, const Budget &budget,
+        unsigned int seed, const SearchOptions &searchOptions
 ) : instance(instance), W(instance.getW()), RD(instance.getRD()), itNi(itNi), alpha(alpha),
-    timeLimit(timeLimit) {
-    NeighborSearch ns(instance, false);
+    timeLimit(timeLimit), budget(budget), lowerBound(LowerBound(instance).value()),
+    generator(Random::derive(seed, Random::GRASP)) {
+    NeighborSearch ns(instance, seed, false, searchOptions);
     bestSolution = Solution::INF();
 
     beginTime = steady_clock::now();
     const steady_clock::time_point maxTime = beginTime + seconds(this->timeLimit);
 
     unsigned int iterationsNotImproved = 0;
-    while (iterationsNotImproved < this->itNi && steady_clock::now() < maxTime) {
+    while (iterationsNotImproved < this->itNi && steady_clock::now() < maxTime
+           && !budget.exhausted(offspring, ns.getEvaluations(), 0) && bestSolution->time > lowerBound) {
         Solution *newSolution = constructSolution();
+        offspring++;
         ns.educate(newSolution);
 
         if (newSolution->time < bestSolution->time) {
@@ -34,6 +37,7 @@ Grasp::Grasp(
         }
     }
 
+    evaluations = ns.getEvaluations();
     endTime = steady_clock::now();
 }
 
@@ -57,7 +61,6 @@ struct Insertion {
 };
 
 Solution *Grasp::constructSolution() {
-    mt19937 generator((random_device()) ());
     uniform_int_distribution<unsigned int> distClients(1, instance.nClients());
 
     // start solution with one route with two clients
@@ -71,6 +74,8 @@ Solution *Grasp::constructSolution() {
     routeRD.push_back(max(RD[a], RD[b]));
     routeStart.push_back(routeRD.back());
     routeTime.push_back(W[0][a] + W[a][b] + W[b][0]);
+    Schedule schedule; // the routes after each route are composed in O(log R)
+    schedule.build(routeRD, routeTime);
 
     set<unsigned int> remainingClients;
     for (unsigned int i = 1; i < instance.nVertex(); i++) {
@@ -87,6 +92,7 @@ Solution *Grasp::constructSolution() {
 
         for (unsigned int r = 0; r < routes.size(); r++) {
             const vector<unsigned int> &route = *(routes[r]);
+            const MaxPlus after = schedule.range(r + 1, (int) routes.size() - 1); // the routes after r
             for (unsigned int i = 0; i < routes[r]->size() - 1; i++) { // in each arc
                 unsigned int preRD = routeRD[r];
                 unsigned int preTime = routeTime[r] - W[route[i]][route[i + 1]];
@@ -98,11 +104,7 @@ Solution *Grasp::constructSolution() {
                     unsigned int time = r == 0 ? thisRD : max(thisRD, routeStart[r - 1] + routeTime[r - 1]);
                     time += thisTime; // ending time of route
                     const int routeCost = (int) time - (int) (routeStart[r] + routeTime[r]); // of current route
-
-                    for (unsigned int x = r + 1; x < routes.size(); x++) {
-                        time = max(time, routeRD[x]); // starting time of route x
-                        time += routeTime[x]; // ending time of route x
-                    }
+                    time = after.apply(time); // ending time of the last route
 
                     const int finalTimeCost = (int) time - (int) (routeStart.back() + routeTime.back());
                     insertions.push_back(new Insertion(v, r, i, routeCost, finalTimeCost, thisRD, thisTime));
@@ -113,6 +115,7 @@ Solution *Grasp::constructSolution() {
 
         for (unsigned int r = 0; r < routes.size(); r++) {
             const vector<unsigned int> &route = *(routes[r]);
+            const MaxPlus after = schedule.range(r + 1, (int) routes.size() - 1);
 
             vector<unsigned int> totalTimeForward(route.size()); // total time of going from the depot to the i-th clt
             vector<unsigned int> maxRDForward(route.size()); // higher RD between all from the depot to the i-th element
@@ -143,11 +146,7 @@ Solution *Grasp::constructSolution() {
                 time = max(time, rd1) + time1; // ending time of first route
                 time = max(time, rd2) + time2; // ending time of second route
                 const int routeCost = (int) time - (int) (routeStart[r] + routeTime[r]);
-
-                for (unsigned int x = r + 1; x < routes.size(); x++) {
-                    time = max(time, routeRD[x]); // starting time of route x
-                    time += routeTime[x]; // ending time of route x
-                }
+                time = after.apply(time);
                 const int finalTimeCost = (int) time - (int) (routeStart.back() + routeTime.back());
 
                 insertions.push_back(new Insertion(0, r, i, routeCost, finalTimeCost, rd1, time1, rd2, time2));
@@ -163,7 +162,7 @@ Solution *Grasp::constructSolution() {
             }
         });
 
-        uniform_int_distribution<unsigned int> dist(0, (int) alpha * (insertions.size() - 1));
+        uniform_int_distribution<unsigned int> dist(0, (unsigned int) (alpha * (insertions.size() - 1)));
         Insertion *sel = insertions[dist(generator)];
 
         if (sel->vertex == 0) { // depot insertion
@@ -173,7 +172,7 @@ Solution *Grasp::constructSolution() {
                                  make_move_iterator(routes[sel->route]->begin() + sel->position),
                                  make_move_iterator(routes[sel->route]->end())
                                  ));
-            routes[sel->route][sel->position] = routes[sel->route + 1][0]; // restore moved element
+            routes[sel->route]->at(sel->position) = routes[sel->route + 1]->at(0); // restore moved element
             routes[sel->route + 1]->at(0) = 0; // change moved element to depot
             routes[sel->route]->at(sel->position + 1) = 0; // end depot
             routes[sel->route]->resize(sel->position + 2);
@@ -184,15 +183,17 @@ Solution *Grasp::constructSolution() {
             routeTime[sel->route] = sel->newTime;
             routeTime.insert(routeTime.begin() + sel->route + 1, sel->newTime2);
             routeStart.push_back(0); // only increase the size to update after
+            schedule.build(routeRD, routeTime);
         } else { // client insertion
             routes[sel->route]->insert(routes[sel->route]->begin() + sel->position + 1, sel->vertex);
             routeRD[sel->route] = sel->newRD;
             routeTime[sel->route] = sel->newTime;
+            schedule.set(sel->route, sel->newRD, sel->newTime);
         }
 
         // update starting times of routes
         for (unsigned int r = sel->route; r < routes.size(); r++) {
-            routeStart[r] = r == 0 ? RD[r] : max(RD[r], routeStart[r - 1] + routeTime[r - 1]);
+            routeStart[r] = r == 0 ? routeRD[r] : max(routeRD[r], routeStart[r - 1] + routeTime[r - 1]);
         }
 
         remainingClients.erase(sel->vertex);
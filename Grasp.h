@@ -2,28 +2,40 @@
 #define TSPRD_GRASP_H
 
 #include "Solution.h"
+#include "Random.h"
+#include "Budget.h"
+#include "LowerBound.h"
+#include "NeighborSearch.h"
 #include <chrono>
 
 using namespace chrono;
 
 class Grasp {
     const Instance &instance;
-    const vector<vector<unsigned int> > &W;
+    const DistanceMatrix &W;
     const vector<unsigned int> &RD;
     unsigned int itNi; // iterations without improvement to stop algorithm
     const double alpha;
     const unsigned int timeLimit;
+    const Budget budget;
+    const unsigned int lowerBound; // the search stops when the best solution reaches it, see LowerBound
 
     Solution *bestSolution;
 
+    mt19937 generator;
+
     steady_clock::time_point beginTime;
     steady_clock::time_point endTime;
     steady_clock::time_point bestSolutionFoundTime;
 
+    unsigned long long offspring = 0; // number of constructed solutions
+    unsigned long long evaluations = 0; // moves evaluated by the neighbor search
+
     Solution *constructSolution();
 
 public:
-    explicit Grasp(const Instance &instance, unsigned int itNi, double alpha, unsigned int timeLimit);
+    Grasp(const Instance &instance, unsigned int itNi, double alpha, unsigned int timeLimit, const Budget &budget,
+          unsigned int seed, const SearchOptions &searchOptions = SearchOptions());
 
     const Solution &getSolution() {
         return *bestSolution;
@@ -35,6 +47,22 @@ public:
     unsigned int getBestSolutionTime() {
         return duration_cast<milliseconds>(bestSolutionFoundTime - beginTime).count();
     }
+
+    unsigned int getLowerBound() const {
+        return lowerBound;
+    }
+
+    unsigned long long getOffspring() const {
+        return offspring;
+    }
+
+    unsigned long long getEvaluations() const {
+        return evaluations;
+    }
+
+    unsigned long long getSplits() const {
+        return 0; // the grasp constructs the routes directly and its neighbor search does not split
+    }
 };
 
 #endif //TSPRD_GRASP_H
@@ -2,6 +2,8 @@
 #include <fstream>
 #include <iostream>
 #include <cmath>
+#include <numeric>
+#include <algorithm>
 
 // read the stream until 's' appear
 void readUntil(ifstream &in, const string &s) {
@@ -11,7 +13,8 @@ void readUntil(ifstream &in, const string &s) {
     }
 }
 
-Instance::Instance(const string &instance) : V(0), W(0), RD(0), biggerRD(0), symmetric(false) {
+Instance::Instance(const string &instance, bool relabel)
+        : name(instance), V(0), RD(0), biggerRD(0), symmetric(false), depotTriangular(true), relabeled(relabel) {
 
     ifstream in(("instances/" + instance + ".dat").c_str(), ios::in);
     if (!in) {
@@ -21,21 +24,23 @@ Instance::Instance(const string &instance) : V(0), W(0), RD(0), biggerRD(0), sym
 
     string instanceSet = instance.substr(0, instance.find('/'));
     if (instanceSet == "aTSPLIB") {
-        readDistanceMatrixInstance(in);
+        readDistanceMatrixInstance(in, relabel);
     } else if (instanceSet == "TSPLIB" || instanceSet == "Solomon" || instanceSet == "testSet") {
-        readCoordinatesListInstance(in);
+        readCoordinatesListInstance(in, relabel);
     } else {
         cout << "ERROR unknown_instance_set" << endl;
         exit(1);
     }
 
     in.close();
+
+    buildNearestClients();
 }
 
-void Instance::readDistanceMatrixInstance(ifstream &in) {
+void Instance::readDistanceMatrixInstance(ifstream &in, bool relabel) {
     readUntil(in, "DIMENSION:");
     in >> V;
-    W.resize(V, vector<unsigned int>(V));
+    W.resize(V);
     RD.resize(V);
 
     readUntil(in, "EDGE_WEIGHT_SECTION");
@@ -60,21 +65,31 @@ void Instance::readDistanceMatrixInstance(ifstream &in) {
             symmetric = symmetric && (W[i][j] == W[j][i]);
         }
     }
+
+    // the matrices are not closed by floyd warshall
+    for (unsigned int a = 1; a < V && depotTriangular; a++) {
+        for (unsigned int b = 1; b < V && depotTriangular; b++) {
+            depotTriangular = a == b || W[0][a] + W[a][b] >= W[0][b];
+        }
+    }
+
+    originalIds.resize(V);
+    iota(originalIds.begin(), originalIds.end(), 0);
+    if (relabel) renumber(nearestNeighbourOrder());
 }
 
-void Instance::readCoordinatesListInstance(ifstream &in) {
+void Instance::readCoordinatesListInstance(ifstream &in, bool relabel) {
     symmetric = true;
 
     readUntil(in, "<DIMENSION>");
     in >> V;
 
-    W.resize(V, vector<unsigned int>(V));
     RD.resize(V);
 
     readUntil(in, "</VERTICES>");
 
-    vector<double> X(V);
-    vector<double> Y(V);
+    X.resize(V);
+    Y.resize(V);
     double aux;
 
     biggerRD = 0;
@@ -90,6 +105,34 @@ void Instance::readCoordinatesListInstance(ifstream &in) {
             biggerRD = RD[i];
     }
 
+    originalIds.resize(V);
+    iota(originalIds.begin(), originalIds.end(), 0);
+    if (relabel) {
+        // the vertices are renumbered before the distances are computed
+        originalIds = hilbertOrder(X, Y);
+        vector<double> relabeledX(V), relabeledY(V);
+        vector<unsigned int> relabeledRD(V);
+        for (unsigned int v = 0; v < V; v++) {
+            relabeledX[v] = X[originalIds[v]];
+            relabeledY[v] = Y[originalIds[v]];
+            relabeledRD[v] = RD[originalIds[v]];
+        }
+        X = move(relabeledX);
+        Y = move(relabeledY);
+        RD = move(relabeledRD);
+    }
+
+    vector<unsigned int> clients(V - 1);
+    iota(clients.begin(), clients.end(), 1);
+    clientsIndex = SpatialIndex(X, Y, clients);
+
+    if (V > MATRIX_FREE_VERTICES) {
+        // the distances between clients are not closed, only those from and to the depot
+        W.setCoordinates(X, Y);
+        return;
+    }
+
+    W.resize(V);
 
     // calculate rounded euclidian distances between each pair of vertex
     for (unsigned int i = 0; i < V; i++) {
@@ -100,7 +143,7 @@ void Instance::readCoordinatesListInstance(ifstream &in) {
 
             double distance = sqrt(a * a + b * b);
 
-            W[i][j] = floor(distance + 0.5);
+            W[i][j] = DistanceMatrix::round(distance);
             W[j][i] = W[i][j];
         }
     }
@@ -115,6 +158,106 @@ void Instance::readCoordinatesListInstance(ifstream &in) {
     }
 }
 
+// the vertices sorted by their position in a hilbert curve over the bounding box of the coordinates, the depot first
+vector<unsigned int> Instance::hilbertOrder(const vector<double> &X, const vector<double> &Y) {
+    const unsigned int V = X.size();
+    const unsigned int side = 1u << 16u; // cells of the curve in each axis
+    const double minX = *min_element(X.begin(), X.end()), maxX = *max_element(X.begin(), X.end());
+    const double minY = *min_element(Y.begin(), Y.end()), maxY = *max_element(Y.begin(), Y.end());
+    const double scale = (side - 1) / max(max(maxX - minX, maxY - minY), 1e-9);
+
+    vector<unsigned long long> index(V);
+    for (unsigned int v = 0; v < V; v++) {
+        auto x = (unsigned int) ((X[v] - minX) * scale), y = (unsigned int) ((Y[v] - minY) * scale);
+        unsigned long long d = 0;
+        for (unsigned int s = side / 2; s > 0; s /= 2) {
+            const unsigned int rx = (x & s) > 0, ry = (y & s) > 0;
+            d += (unsigned long long) s * s * ((3 * rx) ^ ry);
+            if (ry == 0) { // rotates the quadrant
+                if (rx == 1) {
+                    x = side - 1 - x;
+                    y = side - 1 - y;
+                }
+                swap(x, y);
+            }
+        }
+        index[v] = d;
+    }
+
+    vector<unsigned int> order(V);
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin() + 1, order.end(), [&](unsigned int a, unsigned int b) {
+        return index[a] < index[b];
+    });
+    return order;
+}
+
+// a tour that starts at the depot and goes each time to the closest client not visited yet
+vector<unsigned int> Instance::nearestNeighbourOrder() const {
+    vector<unsigned int> order(1, 0);
+    vector<bool> visited(V, false);
+    visited[0] = true;
+    for (unsigned int k = 1; k < V; k++) {
+        const DistanceMatrix::Row row = W[order.back()];
+        unsigned int next = 0;
+        for (unsigned int c = 1; c < V; c++) {
+            if (!visited[c] && (next == 0 || row[c] < row[next])) next = c;
+        }
+        order.push_back(next);
+        visited[next] = true;
+    }
+    return order;
+}
+
+// the vertex order[v] of the file gets the id v, for the matrix instances
+void Instance::renumber(const vector<unsigned int> &order) {
+    DistanceMatrix relabeled;
+    relabeled.resize(V);
+    vector<unsigned int> relabeledRD(V);
+    for (unsigned int i = 0; i < V; i++) {
+        for (unsigned int j = 0; j < V; j++) {
+            relabeled[i][j] = W[order[i]][order[j]];
+        }
+        relabeledRD[i] = RD[order[i]];
+    }
+    W = move(relabeled);
+    RD = move(relabeledRD);
+    originalIds = order;
+}
+
+// O(V log V) time with the spatial index of the coordinate instances, O(V^2) in the matrix instances, where the rows of W
+// are scanned one at a time
+void Instance::buildNearestClients() {
+    nNearest = V > NEAREST_CLIENTS + 2 ? NEAREST_CLIENTS : (V > 2 ? V - 2 : 0);
+    nearest.assign((size_t) V * nNearest, 0);
+    if (hasCoordinates()) {
+        vector<unsigned int> closest;
+        for (unsigned int c = 1; c < V; c++) {
+            // c itself is among the closest points, unless other clients are at the same position
+            clientsIndex.nearest(X[c], Y[c], nNearest + 1, closest);
+            auto self = find(closest.begin(), closest.end(), c);
+            closest.erase(self != closest.end() ? self : closest.end() - 1);
+            copy(closest.begin(), closest.end(), nearest.begin() + (size_t) c * nNearest);
+        }
+        return;
+    }
+
+    vector<unsigned int> row(V), clients;
+    for (unsigned int c = 1; c < V; c++) {
+        W.row(c, row.data());
+        clients.clear();
+        for (unsigned int x = 1; x < V; x++) {
+            if (x != c) clients.push_back(x);
+        }
+        auto closer = [&row](unsigned int a, unsigned int b) {
+            return row[a] < row[b] || (row[a] == row[b] && a < b);
+        };
+        nth_element(clients.begin(), clients.begin() + nNearest, clients.end(), closer);
+        sort(clients.begin(), clients.begin() + nNearest, closer);
+        copy(clients.begin(), clients.begin() + nNearest, nearest.begin() + (size_t) c * nNearest);
+    }
+}
+
 unsigned int Instance::nVertex() const {
     return V;
 }
@@ -131,7 +274,7 @@ unsigned int Instance::time(unsigned int i, unsigned int j) const {
     return W[i][j];
 }
 
-const vector<vector<unsigned int> > &Instance::getW() const {
+const DistanceMatrix &Instance::getW() const {
     return W;
 }
 
@@ -3,22 +3,52 @@
 
 #include <vector>
 #include <string>
+#include "DistanceMatrix.h"
+#include "SpatialIndex.h"
 
 using namespace std;
 
 class Instance {
+    string name;
     unsigned int V;
-    vector<vector<unsigned int> > W;
+    DistanceMatrix W;
     vector<unsigned int> RD;
     unsigned int biggerRD;
     bool symmetric;
+    bool depotTriangular; // see isDepotTriangular()
+    vector<unsigned int> originalIds; // id of each vertex in the instance file
+    bool relabeled; // see isRelabeled()
+    vector<double> X, Y; // coordinates of the vertices, empty in the matrix instances
+    SpatialIndex clientsIndex; // of the clients, in the coordinate instances
+    unsigned int nNearest = 0;
+    vector<unsigned int> nearest; // nearestClients(c) at [c * nNearest]
 
-    void readDistanceMatrixInstance(ifstream &in);
+    void readDistanceMatrixInstance(ifstream &in, bool relabel);
 
-    void readCoordinatesListInstance(ifstream &in);
+    void readCoordinatesListInstance(ifstream &in, bool relabel);
+
+    static vector<unsigned int> hilbertOrder(const vector<double> &X, const vector<double> &Y);
+
+    vector<unsigned int> nearestNeighbourOrder() const;
+
+    void renumber(const vector<unsigned int> &order);
+
+    void buildNearestClients();
 
 public:
-    explicit Instance(const string &filename);
+    // coordinate instances with more vertices keep only the coordinates (see DistanceMatrix): the matrix would take
+    // V^2 * 4 bytes (1.6 GB at 20000 vertices) and its floyd warshall closure O(V^3) time
+    static const unsigned int MATRIX_FREE_VERTICES = 5000;
+
+    static const unsigned int NEAREST_CLIENTS = 20;
+
+    /*
+     * with 'relabel', the clients are renumbered so that the clients close to each other get close ids, and the rows
+     * of W read together in the neighborhoods are close in memory: in the order of a hilbert curve over the
+     * coordinates, or of a nearest neighbour tour from the depot for the matrix instances (the depot stays 0)
+     * all the structures use the new ids, originalId() gives back the id of the file
+     */
+    explicit Instance(const string &filename, bool relabel = false);
 
     unsigned int releaseDateOf(unsigned int c) const;
 
@@ -28,13 +58,61 @@ public:
 
     unsigned int nClients() const;
 
-    const vector<vector<unsigned int> > &getW() const;
+    const DistanceMatrix &getW() const;
 
     const vector<unsigned int> &getRD() const;
 
+    // the clients closest to the client c, closest first, for the candidates of the moves: by the euclidean distance
+    // in the coordinate instances (found with the spatial index), by W[c][.] in the matrix instances
+    const unsigned int *nearestClients(unsigned int c) const {
+        return nearest.data() + (size_t) c * nNearest;
+    }
+
+    // size of the lists of nearestClients(), NEAREST_CLIENTS or all the other clients in the small instances
+    unsigned int nNearestClients() const {
+        return nNearest;
+    }
+
+    bool hasCoordinates() const {
+        return !X.empty();
+    }
+
+    const vector<double> &getX() const {
+        return X;
+    }
+
+    const vector<double> &getY() const {
+        return Y;
+    }
+
+    // k nearest and radius queries over the coordinates of the clients, empty in the matrix instances
+    const SpatialIndex &getClientsIndex() const {
+        return clientsIndex;
+    }
+
+    unsigned int originalId(unsigned int v) const {
+        return originalIds[v];
+    }
+
+    // the clients were renumbered, the instance read again without 'relabel' has the ids of the file
+    bool isRelabeled() const {
+        return relabeled;
+    }
+
+    const string &getName() const {
+        return name;
+    }
+
     bool isSymmetric() const {
         return symmetric;
     }
+
+    // W[0][a] + W[a][b] >= W[0][b] for all the clients a != b: a route never gets shorter when a client is added at
+    // its start, which the split uses to stop extending the routes (always true after the floyd warshall closure, and
+    // in the coordinate mode, where the times of the depot are closed)
+    bool isDepotTriangular() const {
+        return depotTriangular;
+    }
 };
 
 
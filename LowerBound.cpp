@@ -0,0 +1,109 @@
+#include "LowerBound.h"
+#include <limits>
+#include <algorithm>
+#include <numeric>
+
+// dijkstra from the depot (or to the depot, over the reversed arcs), O(V^2)
+vector<unsigned int> LowerBound::shortestPaths(const Instance &instance, bool toDepot) {
+    const unsigned int V = instance.nVertex();
+    const DistanceMatrix &W = instance.getW();
+    vector<unsigned int> distance(V, numeric_limits<unsigned int>::max()), row(V);
+    vector<bool> closed(V, false);
+    distance[0] = 0;
+    for (unsigned int k = 0; k < V; k++) {
+        unsigned int u = V;
+        for (unsigned int v = 0; v < V; v++) {
+            if (!closed[v] && (u == V || distance[v] < distance[u])) u = v;
+        }
+        closed[u] = true;
+        if (toDepot && !instance.isSymmetric()) {
+            for (unsigned int v = 0; v < V; v++) {
+                distance[v] = min(distance[v], W[v][u] + distance[u]);
+            }
+        } else {
+            W.row(u, row.data());
+            for (unsigned int v = 0; v < V; v++) {
+                distance[v] = min(distance[v], distance[u] + row[v]);
+            }
+        }
+    }
+    return distance;
+}
+
+// prim over min(W[i][j], W[j][i]), O(V^2)
+unsigned long long LowerBound::spanningTree(const Instance &instance) {
+    const unsigned int V = instance.nVertex();
+    const DistanceMatrix &W = instance.getW();
+    vector<unsigned int> cost(V, numeric_limits<unsigned int>::max()), row(V);
+    vector<bool> inTree(V, false);
+    cost[0] = 0;
+    unsigned long long total = 0;
+    for (unsigned int k = 0; k < V; k++) {
+        unsigned int u = V;
+        for (unsigned int v = 0; v < V; v++) {
+            if (!inTree[v] && (u == V || cost[v] < cost[u])) u = v;
+        }
+        inTree[u] = true;
+        total += cost[u];
+        W.row(u, row.data());
+        for (unsigned int v = 0; v < V; v++) {
+            if (inTree[v]) continue;
+            const unsigned int arc = instance.isSymmetric() ? row[v] : min(row[v], W[v][u]);
+            cost[v] = min(cost[v], arc);
+        }
+    }
+    return total;
+}
+
+LowerBound::LowerBound(const Instance &instance) {
+    const unsigned int V = instance.nVertex();
+    if (V < 2) return;
+    const DistanceMatrix &W = instance.getW();
+    const vector<unsigned int> &RD = instance.getRD();
+
+    const vector<unsigned int> fromDepot = shortestPaths(instance, false);
+    const vector<unsigned int> toDepot = instance.isSymmetric() ? fromDepot : shortestPaths(instance, true);
+
+    // cheapest arcs into and out of each vertex, from and to the other vertices
+    vector<unsigned int> minIn(V, numeric_limits<unsigned int>::max()), minOut(V, numeric_limits<unsigned int>::max());
+    vector<unsigned int> row(V);
+    for (unsigned int i = 0; i < V; i++) {
+        W.row(i, row.data());
+        for (unsigned int j = 0; j < V; j++) {
+            if (i == j) continue;
+            minOut[i] = min(minOut[i], row[j]);
+            minIn[j] = min(minIn[j], row[j]);
+        }
+    }
+    // the depot is entered and left from and to clients
+    unsigned int depotIn = numeric_limits<unsigned int>::max(), depotOut = numeric_limits<unsigned int>::max();
+    for (unsigned int c = 1; c < V; c++) {
+        depotIn = min(depotIn, W[c][0]);
+        depotOut = min(depotOut, W[0][c]);
+    }
+
+    for (unsigned int c = 1; c < V; c++) {
+        roundTrip = max(roundTrip, RD[c] + fromDepot[c] + toDepot[c]);
+    }
+
+    // the clients from the latest release date to the earliest, the bound of t once all the clients of t are added
+    vector<unsigned int> clients(V - 1);
+    iota(clients.begin(), clients.end(), 1);
+    sort(clients.begin(), clients.end(), [&RD](unsigned int a, unsigned int b) {
+        return RD[a] > RD[b];
+    });
+    const unsigned long long treeBound = RD[clients.back()] + spanningTree(instance) + min(depotIn, depotOut);
+    tree = (unsigned int) min(treeBound, (unsigned long long) numeric_limits<unsigned int>::max());
+
+    unsigned long long sumIn = depotIn, sumOut = depotOut;
+    unsigned int trip = 0;
+    for (unsigned int k = 0; k < clients.size(); k++) {
+        const unsigned int c = clients[k];
+        sumIn += minIn[c];
+        sumOut += minOut[c];
+        trip = max(trip, fromDepot[c] + toDepot[c]);
+        if (k + 1 < clients.size() && RD[clients[k + 1]] == RD[c]) continue;
+        const unsigned long long bound = RD[c] + max(max(sumIn, sumOut), (unsigned long long) trip);
+        bucketed = max(bucketed, (unsigned int) min(bound, (unsigned long long) numeric_limits<unsigned int>::max()));
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef TSPRD_LOWERBOUND_H
+#define TSPRD_LOWERBOUND_H
+
+#include <vector>
+#include "Instance.h"
+
+using namespace std;
+
+/*
+ * Valid lower bounds of the completion time of the solutions of an instance, computed in O(V^2)
+ *
+ * a route starts after the release dates of all its clients, so for any date t, the routes with the clients of
+ * release date >= t all start at t or later, and after t the solution still:
+ *   - goes from the depot to each of these clients and back (shortest paths, W is not closed in every instance)
+ *   - enters each of these clients and then the depot once more (the cheapest arc into each of them)
+ *   - leaves the depot and then each of these clients (the cheapest arc out of each of them)
+ * the bound of t is t plus the biggest of the three, and the bound of the instance is the biggest bound over the
+ * release dates of the clients (the second and third ones are the assignment relaxation without its constraints)
+ * with t the release date of a single client, the first one is the usual max over the clients of rd + round trip,
+ * kept apart (getRoundTrip) to compare the bounds
+ *
+ * all the routes start after the earliest release date, and together they connect all the vertices: without the
+ * depot they are paths, which with one arc from the depot to each of them make a spanning tree, and the other arc
+ * of each route with the depot is at least the cheapest one; the tree bound is the earliest release date plus the
+ * minimum spanning tree (over the cheapest direction of each pair of vertices) plus the cheapest arc of the depot
+ */
+class LowerBound {
+    unsigned int roundTrip = 0; // max over the clients of rd + shortest round trip from the depot
+    unsigned int bucketed = 0; // max over the release dates t of the bound of t
+    unsigned int tree = 0; // earliest release date + spanning tree bound
+
+    static vector<unsigned int> shortestPaths(const Instance &instance, bool toDepot);
+
+    static unsigned long long spanningTree(const Instance &instance);
+
+public:
+    explicit LowerBound(const Instance &instance);
+
+    unsigned int value() const {
+        return max(max(roundTrip, bucketed), tree);
+    }
+
+    unsigned int getRoundTrip() const {
+        return roundTrip;
+    }
+
+    unsigned int getBucketed() const {
+        return bucketed;
+    }
+
+    unsigned int getTree() const {
+        return tree;
+    }
+};
+
+#endif //TSPRD_LOWERBOUND_H
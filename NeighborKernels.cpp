@@ -0,0 +1,215 @@
+#include "NeighborKernels.h"
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TSPRD_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// scratch arrays reused between calls, one set per thread
+static thread_local vector<int> bufferA, bufferB, bufferC;
+
+static bool cpuSupportsAvx2() {
+#ifdef TSPRD_AVX2_KERNELS
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+static bool vectorized = cpuSupportsAvx2();
+
+bool NeighborKernels::isVectorized() {
+    return vectorized;
+}
+
+void NeighborKernels::setVectorized(bool v) {
+    vectorized = v && cpuSupportsAvx2();
+}
+
+/*
+ * 2-opt: with F[k] the time of the route from its start to the k-th vertex and B[k] the same time travelling the
+ * arcs backwards, the gain of reversing [i, j] is C[i] + D[j] - W[r[i-1]][r[j]] - W[r[i]][r[j+1]], where
+ * C[i] = W[r[i-1]][r[i]] - F[i] + B[i] and D[j] = F[j+1] - B[j]
+ */
+static void prepareTwoOpt(const DistanceMatrix &W, const unsigned int *route, unsigned int size) {
+    vector<int> &C = bufferA, &D = bufferB;
+    C.resize(size);
+    D.resize(size);
+    int F = 0, B = 0; // F[j] and B[j]
+    for (unsigned int j = 0; j < size - 1; j++) {
+        const int arc = (int) W[route[j]][route[j + 1]];
+        if (j > 0) {
+            B += (int) W[route[j]][route[j - 1]];
+            C[j] = (int) W[route[j - 1]][route[j]] - F + B;
+        }
+        D[j] = F + arc - B;
+        F += arc;
+    }
+}
+
+/*
+ * reinsertion: with A[j] = W[r[j]][r[j+1]], the gain of moving the n clients starting at i after the position j is
+ * fixed(i) + A[j] - W[r[j]][r[i]] - W[r[i+n-1]][r[j+1]]
+ */
+static void prepareReinsertion(const DistanceMatrix &W, const unsigned int *route, unsigned int size) {
+    vector<int> &A = bufferA, &rowOffset = bufferB;
+    A.resize(size);
+    rowOffset.resize(size);
+    for (unsigned int j = 0; j < size - 1; j++) {
+        A[j] = (int) W[route[j]][route[j + 1]];
+        rowOffset[j] = (int) (route[j] * W.size()); // offset of the row of r[j] in the flat matrix
+    }
+}
+
+static void twoOptScalar(const DistanceMatrix &W, const unsigned int *route, unsigned int size,
+                         int &bestGain, unsigned int &bestI, unsigned int &bestJ) {
+    const unsigned int L = size - 2;
+    const int *C = bufferA.data(), *D = bufferB.data();
+    for (unsigned int i = 1; i <= L - 1; i++) {
+        const DistanceMatrix::Row rowA = W[route[i - 1]], rowB = W[route[i]];
+        for (unsigned int j = i + 1; j <= L; j++) {
+            const int gain = C[i] + D[j] - (int) rowA[route[j]] - (int) rowB[route[j + 1]];
+            if (gain > bestGain) {
+                bestGain = gain;
+                bestI = i, bestJ = j;
+            }
+        }
+    }
+}
+
+static inline void reinsertionRangeScalar(const DistanceMatrix &W, const unsigned int *route, int fixed,
+                                          unsigned int i, unsigned int n, unsigned int jFrom, unsigned int jTo,
+                                          int &bestGain, unsigned int &bestI, unsigned int &bestJ) {
+    const int *A = bufferA.data();
+    const unsigned int first = route[i];
+    const DistanceMatrix::Row rowLast = W[route[i + n - 1]];
+    for (unsigned int j = jFrom; j <= jTo; j++) {
+        const int gain = fixed + A[j] - (int) W[route[j]][first] - (int) rowLast[route[j + 1]];
+        if (gain > bestGain) {
+            bestGain = gain;
+            bestI = i, bestJ = j;
+        }
+    }
+}
+
+static void reinsertionScalar(const DistanceMatrix &W, const unsigned int *route, unsigned int size, unsigned int n,
+                              int &bestGain, unsigned int &bestI, unsigned int &bestJ) {
+    const unsigned int L = size - 2;
+    for (unsigned int i = 1; i + n - 1 <= L; i++) {
+        const int fixed = (int) W[route[i - 1]][route[i]] + (int) W[route[i + n - 1]][route[i + n]]
+                          - (int) W[route[i - 1]][route[i + n]];
+        // positions j in [i - 1, i + n - 1] do not move the clients
+        if (i >= 2) reinsertionRangeScalar(W, route, fixed, i, n, 0, i - 2, bestGain, bestI, bestJ);
+        if (i + n <= L) reinsertionRangeScalar(W, route, fixed, i, n, i + n, L, bestGain, bestI, bestJ);
+    }
+}
+
+#ifdef TSPRD_AVX2_KERNELS
+
+// checks the 8 gains in order, keeping the first best one
+static inline void scanLanes(const int *gains, unsigned int i, unsigned int j,
+                             int &bestGain, unsigned int &bestI, unsigned int &bestJ) {
+    for (unsigned int k = 0; k < 8; k++) {
+        if (gains[k] > bestGain) {
+            bestGain = gains[k];
+            bestI = i, bestJ = j + k;
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void twoOptAvx2(const DistanceMatrix &W, const unsigned int *route, unsigned int size,
+                       int &bestGain, unsigned int &bestI, unsigned int &bestJ) {
+    const unsigned int L = size - 2;
+    const int *C = bufferA.data(), *D = bufferB.data();
+    const auto *r = (const int *) route;
+    alignas(32) int gains[8];
+
+    for (unsigned int i = 1; i <= L - 1; i++) {
+        const auto *rowA = (const int *) W.dense()[route[i - 1]], *rowB = (const int *) W.dense()[route[i]];
+        const __m256i c = _mm256_set1_epi32(C[i]);
+
+        unsigned int j = i + 1;
+        for (; j + 7 <= L; j += 8) {
+            const __m256i d = _mm256_loadu_si256((const __m256i *) (D + j));
+            const __m256i a = _mm256_i32gather_epi32(rowA, _mm256_loadu_si256((const __m256i *) (r + j)), 4);
+            const __m256i b = _mm256_i32gather_epi32(rowB, _mm256_loadu_si256((const __m256i *) (r + j + 1)), 4);
+            const __m256i gain = _mm256_sub_epi32(_mm256_sub_epi32(_mm256_add_epi32(c, d), a), b);
+            if (_mm256_movemask_epi8(_mm256_cmpgt_epi32(gain, _mm256_set1_epi32(bestGain)))) {
+                _mm256_store_si256((__m256i *) gains, gain);
+                scanLanes(gains, i, j, bestGain, bestI, bestJ);
+            }
+        }
+        for (; j <= L; j++) {
+            const int gain = C[i] + D[j] - rowA[route[j]] - rowB[route[j + 1]];
+            if (gain > bestGain) {
+                bestGain = gain;
+                bestI = i, bestJ = j;
+            }
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void reinsertionRangeAvx2(const DistanceMatrix &W, const unsigned int *route, int fixed,
+                                 unsigned int i, unsigned int n, unsigned int jFrom, unsigned int jTo,
+                                 int &bestGain, unsigned int &bestI, unsigned int &bestJ) {
+    const int *A = bufferA.data(), *rowOffset = bufferB.data();
+    const auto *r = (const int *) route;
+    const auto *column = (const int *) (W.flat() + route[i]); // W[x][r[i]] = column[x * V]
+    const auto *rowLast = (const int *) W.dense()[route[i + n - 1]];
+    const __m256i f = _mm256_set1_epi32(fixed);
+    alignas(32) int gains[8];
+
+    unsigned int j = jFrom;
+    for (; j + 7 <= jTo; j += 8) {
+        const __m256i a = _mm256_loadu_si256((const __m256i *) (A + j));
+        const __m256i in = _mm256_i32gather_epi32(column, _mm256_loadu_si256((const __m256i *) (rowOffset + j)), 4);
+        const __m256i out = _mm256_i32gather_epi32(rowLast, _mm256_loadu_si256((const __m256i *) (r + j + 1)), 4);
+        const __m256i gain = _mm256_sub_epi32(_mm256_sub_epi32(_mm256_add_epi32(f, a), in), out);
+        if (_mm256_movemask_epi8(_mm256_cmpgt_epi32(gain, _mm256_set1_epi32(bestGain)))) {
+            _mm256_store_si256((__m256i *) gains, gain);
+            scanLanes(gains, i, j, bestGain, bestI, bestJ);
+        }
+    }
+    if (j <= jTo) reinsertionRangeScalar(W, route, fixed, i, n, j, jTo, bestGain, bestI, bestJ);
+}
+
+__attribute__((target("avx2")))
+static void reinsertionAvx2(const DistanceMatrix &W, const unsigned int *route, unsigned int size, unsigned int n,
+                            int &bestGain, unsigned int &bestI, unsigned int &bestJ) {
+    const unsigned int L = size - 2;
+    for (unsigned int i = 1; i + n - 1 <= L; i++) {
+        const int fixed = (int) W[route[i - 1]][route[i]] + (int) W[route[i + n - 1]][route[i + n]]
+                          - (int) W[route[i - 1]][route[i + n]];
+        if (i >= 2) reinsertionRangeAvx2(W, route, fixed, i, n, 0, i - 2, bestGain, bestI, bestJ);
+        if (i + n <= L) reinsertionRangeAvx2(W, route, fixed, i, n, i + n, L, bestGain, bestI, bestJ);
+    }
+}
+
+#endif
+
+void NeighborKernels::twoOpt(const DistanceMatrix &W, const unsigned int *route, unsigned int size,
+                             int &bestGain, unsigned int &bestI, unsigned int &bestJ) {
+    if (size < 4) return; // at least two clients
+    prepareTwoOpt(W, route, size);
+#ifdef TSPRD_AVX2_KERNELS
+    if (vectorized && W.isDense()) return twoOptAvx2(W, route, size, bestGain, bestI, bestJ);
+#endif
+    twoOptScalar(W, route, size, bestGain, bestI, bestJ);
+}
+
+void NeighborKernels::reinsertion(const DistanceMatrix &W, const unsigned int *route, unsigned int size,
+                                  unsigned int n, int &bestGain, unsigned int &bestI, unsigned int &bestJ) {
+    if (size < n + 3) return; // at least one client besides the moved ones
+    prepareReinsertion(W, route, size);
+#ifdef TSPRD_AVX2_KERNELS
+    // the gathers use 32 bits offsets in the flat matrix
+    if (vectorized && W.isDense() && (unsigned long long) W.size() * W.size() < (1ull << 31u))
+        return reinsertionAvx2(W, route, size, n, bestGain, bestI, bestJ);
+#endif
+    reinsertionScalar(W, route, size, n, bestGain, bestI, bestJ);
+}
@@ -0,0 +1,34 @@
+#ifndef TSPRD_NEIGHBORKERNELS_H
+#define TSPRD_NEIGHBORKERNELS_H
+
+#include "DistanceMatrix.h"
+
+/*
+ * Evaluation kernels of the intra route neighborhoods
+ *
+ * each kernel evaluates all the moves of a neighborhood in a route and returns the best one (bestGain, bestI, bestJ),
+ * only updating the outputs for moves with gain higher than the given bestGain; ties keep the first move in the
+ * (i, j) order of the original loops, so the vectorized and the scalar versions always choose the same move
+ *
+ * the inner j loops are data parallel once the arc costs of the route are accumulated in contiguous prefix arrays,
+ * so the AVX2 versions evaluate 8 positions at once, gathering the costs from the flat distance matrix
+ * the version is chosen at runtime from the cpu features, the scalar one is used when W is not stored (see
+ * DistanceMatrix)
+ */
+class NeighborKernels {
+public:
+    // reversal of the sub route [i, j]
+    static void twoOpt(const DistanceMatrix &W, const unsigned int *route, unsigned int size,
+                       int &bestGain, unsigned int &bestI, unsigned int &bestJ);
+
+    // reinsertion of the n clients starting at i after the position j
+    static void reinsertion(const DistanceMatrix &W, const unsigned int *route, unsigned int size, unsigned int n,
+                            int &bestGain, unsigned int &bestI, unsigned int &bestJ);
+
+    static bool isVectorized();
+
+    // forces the scalar version (false) or the vectorized one when the cpu supports it (true)
+    static void setVectorized(bool vectorized);
+};
+
+#endif //TSPRD_NEIGHBORKERNELS_H
@@ -1,36 +1,64 @@
 #include "NeighborSearch.h"
 #include "Split.h"
+#include "NeighborKernels.h"
 #include <cassert>
 #include <chrono>
 #include <algorithm>
 #include <limits>
 #include <iostream>
+#include <cstdio>
 
 #define F(R) 1 // index of first client in a route
 #define L(R) ((R)->size() - 2) // index of last client in a route
 
 NeighborSearch::NeighborSearch(
-        const Instance &instance, bool applySplit
-) : instance(instance), W(instance.getW()), RD(instance.getRD()), applySplit(applySplit),
-    generator((random_device()) ()) {}
+        const Instance &instance, unsigned int seed, bool applySplit, const SearchOptions &options
+) : instance(instance), W(instance.getW()), RD(instance.getRD()), applySplit(applySplit), options(options),
+    generator(Random::derive(seed, Random::NEIGHBOR_SEARCH)),
+    intraScheduler({1, 2, 3, 4, 5, 6}, options.reaction, options.segment),
+    // the segment operators replace vertexRelocation and interSwap
+    interScheduler(options.segmentOperators ? vector<unsigned int>({3, 4, 5, 6}) : vector<unsigned int>({1, 2, 3}),
+                   options.reaction, options.segment),
+    splitEngine(instance.getW(), instance.getRD(), instance.isDepotTriangular()) {}
+
+void NeighborSearch::nextOrder(const OperatorScheduler &scheduler, vector<unsigned int> &searchOrder) {
+    if (options.adaptiveOrder) {
+        scheduler.order(searchOrder, generator);
+    } else {
+        if (searchOrder.empty()) searchOrder = scheduler.getOperators();
+        shuffle(searchOrder.begin(), searchOrder.end(), generator);
+    }
+}
+
+void NeighborSearch::recordCall(
+        OperatorScheduler &scheduler, unsigned int op, unsigned int gain, unsigned long long evaluationsBefore,
+        chrono::steady_clock::time_point start
+) {
+    if (!options.adaptiveOrder) return;
+    const double cost = options.timeCost ? chrono::duration<double, micro>(chrono::steady_clock::now() - start).count()
+                                         : (double) (evaluations - evaluationsBefore);
+    scheduler.record(op, gain, cost);
+}
 
 unsigned int NeighborSearch::intraSearch(Solution *solution, bool all) {
-    unsigned int N = 6; // number of intra searchs algorithms
-    vector<unsigned int> searchOrder(N);
-    iota(searchOrder.begin(), searchOrder.end(), 1);
-    shuffle(searchOrder.begin(), searchOrder.end(), generator);
-
-    for (int r = (int) solution->routes.size() - 1; r >= 0; r--) {
-//        if(!all && r != solution->routes.size() - 1
-//        && (solution->routeStart[r] + solution->routeTime[r]) < solution->routeRD[r+1])
-//            break; // improving this route do not improve the final solution
+    vector<unsigned int> &searchOrder = intraOrder;
+    searchOrder.clear();
+    nextOrder(intraScheduler, searchOrder);
+
+    // improving the routes before the critical one do not improve the completion time
+    const int first = all ? 0 : (int) criticalRoute(solution);
+    for (int r = (int) solution->routes.size() - 1; r >= first; r--) {
         for (unsigned int i = 0; i < searchOrder.size(); i++) {
+            const unsigned long long evaluationsBefore = evaluations;
+            const auto start = options.timeCost ? chrono::steady_clock::now() : chrono::steady_clock::time_point();
             unsigned int gain = callIntraSearch(solution->routes[r], searchOrder[i]);
+            recordCall(intraScheduler, searchOrder[i], gain, evaluationsBefore, start);
 
             if (gain > 0) {
+                solution->markChanged(r);
                 unsigned int lastMovement = searchOrder[i];
                 i = -1;
-                shuffle(searchOrder.begin(), searchOrder.end(), generator);
+                nextOrder(intraScheduler, searchOrder);
                 if (searchOrder[0] == lastMovement) {
                     swap(searchOrder[0], searchOrder[searchOrder.size() - 1]);
                 }
@@ -39,11 +67,23 @@ unsigned int NeighborSearch::intraSearch(Solution *solution, bool all) {
     }
 
     unsigned int oldTime = solution->time;
-    unsigned int newTime = solution->update();
+    unsigned int newTime = solution->updateChanged();
     return oldTime - newTime;
 }
 
 unsigned int NeighborSearch::callIntraSearch(vector<unsigned int> *route, unsigned int which) {
+#ifdef TSPRD_PROFILE
+    const auto start = chrono::steady_clock::now();
+    const unsigned long long evaluationsBefore = evaluations, movesBefore = moves;
+    const unsigned int gain = runIntraSearch(route, which);
+    recordStats(operatorStats[which - 1], start, evaluationsBefore, movesBefore, gain);
+    return gain;
+#else
+    return runIntraSearch(route, which);
+#endif
+}
+
+unsigned int NeighborSearch::runIntraSearch(vector<unsigned int> *route, unsigned int which) {
     switch (which) {
         case 1:
             return swapSearch(route, 1, 1);
@@ -78,6 +118,7 @@ unsigned int NeighborSearch::swapSearch(vector<unsigned int> *route, unsigned in
 unsigned int NeighborSearch::swapSearchIt(vector<unsigned int> *route, unsigned int n1, unsigned int n2) {
     unsigned int bestI, bestJ; // armazena os indices que representa o melhor swap
     int bestO = 0; // representa a melhora ao realizar o swap acima
+    const RouteView view(*route, W, arcsBuffer1);
 
     /*
      * i: indice do primeiro elemento do primeiro conjunto
@@ -96,57 +137,45 @@ unsigned int NeighborSearch::swapSearchIt(vector<unsigned int> *route, unsigned
      * route.size() - 2: indice do ultimo cliente visitado na rota
      *
      */
-    for (unsigned int i = F(route); (i + n1 - 1) <= L(route); i++) {
-        if (n1 != n2) // so verifica os conjuntos entre os clientes anteriores se os conjuntos tiver tamanhos distindos
-            // para evitar que o mesmo conjunto seja verificado duas vezes
-            for (unsigned int j = 1; (j + n2 - 1) < i; j++) {
-                int gain = verifySwap(route, j, i, n2, n1);
+    if (!W.isDense()) {
+        markRoutes(*route);
+        swapCandidates(view, n1, n2, bestO, bestI, bestJ);
+    } else {
+        for (unsigned int i = view.first(); (i + n1 - 1) <= view.last(); i++) {
+            if (n1 != n2) // so verifica os conjuntos entre os clientes anteriores se os conjuntos tiver tamanhos
+                // distindos para evitar que o mesmo conjunto seja verificado duas vezes
+                for (unsigned int j = 1; (j + n2 - 1) < i; j++) {
+                    int gain = verifySwap(view, j, i, n2, n1);
+                    evaluations++;
+                    if (gain > bestO) {
+                        bestI = i;
+                        bestJ = j;
+                        bestO = gain;
+                    }
+                }
+            for (unsigned int j = (i + n1 - 1) + 1; (j + n2 - 1) <= view.last(); j++) {
+                int gain = verifySwap(view, i, j, n1, n2);
+                evaluations++;
                 if (gain > bestO) {
                     bestI = i;
                     bestJ = j;
                     bestO = gain;
                 }
             }
-        for (unsigned int j = (i + n1 - 1) + 1; (j + n2 - 1) <= L(route); j++) {
-            int gain = verifySwap(route, i, j, n1, n2);
-            if (gain > bestO) {
-                bestI = i;
-                bestJ = j;
-                bestO = gain;
-            }
         }
     }
 
     if (bestO > 0) { // se ha uma melhora possivel, realiza o swap
+        moves++;
         if (bestI > bestJ) {
             swap(bestI, bestJ);
             swap(n1, n2);
         }
 
-        vector<unsigned int> a(route->begin() + bestI, route->begin() + bestI + n1); // primeiro conjunto
-        vector<unsigned int> b(route->begin() + bestJ, route->begin() + bestJ + n2); // segundo conjunto
-        int diff = (int) n2 - (int) n1;
-
-        // desloca os elementos que estão entre os conjuntos para suas posições finais
-        if (diff < 0) {
-            for (unsigned int i = bestI + n1; i < bestJ; i++) {
-                route->at(i + diff) = route->at(i);
-            }
-        } else if (diff > 0) {
-            for (unsigned int i = bestJ - 1; i >= bestI + n1; i--) {
-                route->at(i + diff) = route->at(i);
-            }
-        }
-
-        // copia o primeiro conjunto
-        for (unsigned int x = 0; x < a.size(); x++) {
-            route->at(bestJ + diff + x) = a[x];
-        }
-
-        // copia o segundo conjunto
-        for (unsigned int x = 0; x < b.size(); x++) {
-            route->at(bestI + x) = b[x];
-        }
+        // a b c -> b a c -> b c a, where a and b are the sets and c the elements between them
+        auto begin = route->begin();
+        rotate(begin + bestI, begin + bestJ, begin + bestJ + n2);
+        rotate(begin + bestI + n2, begin + bestI + n2 + n1, begin + bestJ + n2);
     }
 
     return bestO;
@@ -166,31 +195,31 @@ unsigned int NeighborSearch::swapSearchIt(vector<unsigned int> *route, unsigned
  * enquando um negativo representa um aumento (piora)
  */
 int NeighborSearch::verifySwap(
-        vector<unsigned int> *route, unsigned int i1, unsigned int i2,
+        const RouteView &route, unsigned int i1, unsigned int i2,
         unsigned int n1, unsigned int n2
 ) {
     assert(i1 + n1 - 1 < i2);
-    assert(i2 + n2 - 1 <= route->size() - 2);
+    assert(i2 + n2 - 1 <= route.last());
 
-    unsigned int minus = W[route->at(i1 - 1)][route->at(i1)] // antes do primeiro conjunto
-                         + W[route->at(i2 - 1)][route->at(i2)] // antes do segundo conjunto
-                         + W[route->at(i2 + n2 - 1)][route->at(i2 + n2)]; // depois do segundo conjunto;
+    unsigned int minus = route.arc(i1 - 1) // antes do primeiro conjunto
+                         + route.arc(i2 - 1) // antes do segundo conjunto
+                         + route.arc(i2 + n2 - 1); // depois do segundo conjunto;
 
-    unsigned int plus = W[route->at(i1 - 1)][route->at(i2)]
-                        + W[route->at(i1 + n1 - 1)][route->at(i2 + n2)];
+    unsigned int plus = W[route[i1 - 1]][route[i2]]
+                        + W[route[i1 + n1 - 1]][route[i2 + n2]];
 
 
     if (i1 + n1 == i2) { // se os conjuntos são adjacentes
         // no caso de conj adj sera criado um arc entre o ult cl do primeiro conjunto e primeiro cl do segundo
-        plus += W[route->at(i2 + n2 - 1)][route->at(i1)];
+        plus += W[route[i2 + n2 - 1]][route[i1]];
     } else {
         // quando os dois conjuntos são adjacentes os arco depois do primeiro conjunto e equivalente ao arco
         // antes do segundo conjunto, por isso so adicionamos o arco depois do primeiro conjunto no caso em que
         // os conjuntos não são adjacentes, para que não seja contado 2 vezes o seu peso
-        minus += W[route->at(i1 + n1 - 1)][route->at(i1 + n1)]; // depois do primeiro conjunto
+        minus += route.arc(i1 + n1 - 1); // depois do primeiro conjunto
 
-        plus += W[route->at(i2 - 1)][route->at(i1)]
-                + W[route->at(i2 + n2 - 1)][route->at(i1 + n1)];
+        plus += W[route[i2 - 1]][route[i1]]
+                + W[route[i2 + n2 - 1]][route[i1 + n1]];
     }
 
     return (int) minus - (int) plus;
@@ -221,31 +250,18 @@ unsigned int NeighborSearch::reinsertionSearchIt(vector<unsigned int> *route, un
     unsigned int bestI, bestJ;
     int bestGain = 0;
 
-    for (unsigned int i = 1; i + n - 1 <= L(route); i++) {
-        int minusFixed = (int) W[route->at(i - 1)][route->at(i)]
-                         + (int) W[route->at(i + n - 1)][route->at(i + n)];
-        int plusFixed = (int) W[route->at(i - 1)][route->at(i + n)];
-
-        for (unsigned int j = 0; j <= L(route); j++) {
-            if (j >= i - 1 && j <= i + n - 1)
-                continue;
-
-            int minus = minusFixed
-                        + (int) W[route->at(j)][route->at(j + 1)];
-            int plus = plusFixed
-                       + (int) W[route->at(j)][route->at(i)]
-                       + (int) W[route->at(i + n - 1)][route->at(j + 1)];
-
-            int gain = minus - plus;
-            if (gain > bestGain) {
-                bestI = i;
-                bestJ = j;
-                bestGain = gain;
-            }
-        }
+    // gain of moving the set [i, i + n - 1] after j:
+    // W[i-1][i] + W[i+n-1][i+n] + W[j][j+1] - W[i-1][i+n] - W[j][i] - W[i+n-1][j+1]
+    if (!W.isDense()) {
+        reinsertionCandidates(*route, n, bestGain, bestI, bestJ);
+    } else {
+        NeighborKernels::reinsertion(W, route->data(), route->size(), n, bestGain, bestI, bestJ);
+        if (route->size() >= n + 3)
+            evaluations += (L(route) - n + 1) * (L(route) - n);
     }
 
     if (bestGain > 0) { // perform reinsertion
+        moves++;
         if (bestI > bestJ) {
             // rotate vertex backwards
             rotate(route->begin() + bestJ + 1, route->begin() + bestI, route->begin() + bestI + n);
@@ -275,56 +291,143 @@ unsigned int NeighborSearch::twoOptSearchIt(vector<unsigned int> *route) {
     unsigned int bestI, bestJ;
     int bestGain = 0;
 
-    for (unsigned int i = 1; i <= L(route) - 1; i++) {
-        int minus = (int) W[route->at(i - 1)][route->at(i)]
-                    + (int) W[route->at(i)][route->at(i + 1)];
-        int plus = 0;
-        for (unsigned int j = i + 1; j <= L(route); j++) {
-            minus += W[route->at(j)][route->at(j + 1)];
-            plus += W[route->at(j)][route->at(j - 1)];
+    // the gain of reversing [i, j] is the time of the removed arcs (i-1, i), (j, j+1) and of the arcs between i and j
+    // minus the time of the new arcs (i-1, j), (i, j+1) and of the arcs between i and j travelled backwards
+    if (!W.isDense()) {
+        twoOptCandidates(*route, bestGain, bestI, bestJ);
+    } else {
+        NeighborKernels::twoOpt(W, route->data(), route->size(), bestGain, bestI, bestJ);
+        evaluations += L(route) * (L(route) - 1) / 2;
+    }
+
+    if (bestGain > 0) { // if improved, perform movement
+        moves++;
+        reverse(route->begin() + bestI, route->begin() + bestJ + 1);
+    }
 
-            int gain = minus - (
-                    plus + (int) W[route->at(i - 1)][route->at(j)] + (int) W[route->at(i)][route->at(j + 1)]);
+    return bestGain;
+}
 
+// the swaps of the coordinate mode where a new arc joins a client to one of its close clients, see granular()
+// the clients of the route must be marked by markRoutes()
+void NeighborSearch::swapCandidates(const RouteView &view, unsigned int n1, unsigned int n2, int &bestGain,
+                                    unsigned int &bestI, unsigned int &bestJ) {
+    for (unsigned int i = view.first(); (i + n1 - 1) <= view.last(); i++) {
+        // the set [j, j + n2 - 1] after view[i - 1], before view[i + n1], or around the set [i, i + n1 - 1]
+        candidates.clear();
+        addCandidates(view[i - 1], false, 0);
+        addCandidates(view[i + n1], false, 1 - (int) n2);
+        addCandidates(view[i], false, 1);
+        addCandidates(view[i + n1 - 1], false, -(int) n2);
+        sortCandidates((int) view.first(), (int) (view.last() - n2) + 1);
+        for (int candidate: candidates) {
+            const unsigned int j = (unsigned int) candidate; // sortCandidates kept it >= view.first()
+            int gain;
+            if (j + n2 - 1 < i) gain = verifySwap(view, j, i, n2, n1);
+            else if (j > i + n1 - 1) gain = verifySwap(view, i, j, n1, n2);
+            else continue; // the sets overlap
+            evaluations++;
             if (gain > bestGain) {
-                bestI = i, bestJ = j;
+                bestI = i;
+                bestJ = j;
                 bestGain = gain;
             }
         }
     }
+}
 
-    if (bestGain > 0) // if improved, perform movement
-        reverse(route->begin() + bestI, route->begin() + bestJ + 1);
+// the reinsertions of the coordinate mode after a client close to the first one of the set, or before a client
+// close to its last one
+void NeighborSearch::reinsertionCandidates(const vector<unsigned int> &route, unsigned int n, int &bestGain,
+                                           unsigned int &bestI, unsigned int &bestJ) {
+    markRoutes(route);
+    const unsigned int L = route.size() - 2;
+    for (unsigned int i = 1; i + n - 1 <= L; i++) {
+        const int fixed = (int) W[route[i - 1]][route[i]] + (int) W[route[i + n - 1]][route[i + n]]
+                          - (int) W[route[i - 1]][route[i + n]];
+        candidates.clear();
+        addCandidates(route[i], false, 0);
+        addCandidates(route[i + n - 1], false, -1);
+        sortCandidates(0, (int) L);
+        for (int j: candidates) {
+            if (j + 1 >= (int) i && j <= (int) (i + n - 1)) continue; // positions that do not move the clients
+            evaluations++;
+            const int gain = fixed + (int) W[route[j]][route[j + 1]] - (int) W[route[j]][route[i]]
+                             - (int) W[route[i + n - 1]][route[j + 1]];
+            if (gain > bestGain) {
+                bestGain = gain;
+                bestI = i, bestJ = j;
+            }
+        }
+    }
+}
 
-    return bestGain;
+// the reversals of the coordinate mode where a new arc joins a client to one of its close clients; the coordinate
+// instances are symmetric, so only the two arcs at the ends of the reversed sub route change
+void NeighborSearch::twoOptCandidates(const vector<unsigned int> &route, int &bestGain, unsigned int &bestI,
+                                      unsigned int &bestJ) {
+    markRoutes(route);
+    const unsigned int L = route.size() - 2;
+    for (unsigned int i = 1; i + 1 <= L; i++) {
+        const unsigned int previous = route[i - 1], first = route[i];
+        const int fixed = (int) W[previous][first];
+        candidates.clear();
+        addCandidates(previous, false, 0);
+        addCandidates(first, false, -1);
+        sortCandidates((int) i + 1, (int) L);
+        evaluations += candidates.size();
+        for (int j: candidates) {
+            const int gain = fixed + (int) W[route[j]][route[j + 1]] - (int) W[previous][route[j]]
+                             - (int) W[first][route[j + 1]];
+            if (gain > bestGain) {
+                bestGain = gain;
+                bestI = i, bestJ = j;
+            }
+        }
+    }
 }
 
-unsigned int NeighborSearch::interSearch(Solution *solution) {
+unsigned int NeighborSearch::interSearch(Solution *solution, bool all) {
     unsigned int oldTime = solution->time;
+    pruneRoutes = !all;
 
-    unsigned int N = 3; // number of inter searches algorithms
-    vector<unsigned int> searchOrder(N);
-    iota(searchOrder.begin(), searchOrder.end(), 1);
-    shuffle(searchOrder.begin(), searchOrder.end(), generator);
+    vector<unsigned int> &searchOrder = interOrder;
+    searchOrder.clear();
+    nextOrder(interScheduler, searchOrder);
 
     for (unsigned int i = 0; i < searchOrder.size(); i++) {
+        const unsigned long long evaluationsBefore = evaluations;
+        const auto start = options.timeCost ? chrono::steady_clock::now() : chrono::steady_clock::time_point();
         unsigned int gain = callInterSearch(solution, searchOrder[i]);
+        recordCall(interScheduler, searchOrder[i], gain, evaluationsBefore, start);
 
         if (gain > 0) {
             unsigned int lastMovement = searchOrder[i];
             i = -1;
-            shuffle(searchOrder.begin(), searchOrder.end(), generator);
+            nextOrder(interScheduler, searchOrder);
             if (searchOrder[0] == lastMovement) {
                 swap(searchOrder[0], searchOrder[searchOrder.size() - 1]);
             }
         }
     }
 
-    unsigned int newTime = solution->update();
+    unsigned int newTime = solution->updateChanged(); // the inter route moves keep the times of the routes updated
     return oldTime - newTime;
 }
 
 unsigned int NeighborSearch::callInterSearch(Solution *solution, unsigned int which) {
+#ifdef TSPRD_PROFILE
+    const auto start = chrono::steady_clock::now();
+    const unsigned long long evaluationsBefore = evaluations, movesBefore = moves;
+    const unsigned int gain = runInterSearch(solution, which);
+    recordStats(operatorStats[INTRA_OPERATORS + which - 1], start, evaluationsBefore, movesBefore, gain);
+    return gain;
+#else
+    return runInterSearch(solution, which);
+#endif
+}
+
+unsigned int NeighborSearch::runInterSearch(Solution *solution, unsigned int which) {
     switch (which) {
         case 1:
             return vertexRelocation(solution);
@@ -332,25 +435,29 @@ unsigned int NeighborSearch::callInterSearch(Solution *solution, unsigned int wh
             return interSwap(solution);
         case 3:
             return insertDepotAndReorder(solution);
+        case 4:
+            return interRouteSearch(solution, &NeighborSearch::orOptIt);
+        case 5:
+            return interRouteSearch(solution, &NeighborSearch::twoOptStarIt);
+        case 6:
+            return interRouteSearch(solution, &NeighborSearch::segmentSwapIt);
         default:
             cout << "ERROR invalid_neighbor_search_id" << endl;
             exit(1);
     }
 }
 
-// calculate the new ending time of route max(r1, r2) given that r1 and r2 changed
-unsigned int NeighborSearch::calculateEndingTime(
-        Solution *solution, unsigned int r1, unsigned int r2
-) {
-    if (r1 > r2) swap(r1, r2);
-    // check ending time of route previous to r1
-    unsigned int time = r1 == 0 ? 0 : solution->routeStart[r1 - 1] + solution->routeTime[r1 - 1];
-
-    for (unsigned int i = r1; i <= r2; i++) {
-        time = max(time, solution->routeRD[i]); // route starting time
-        time += solution->routeTime[i]; // route ending time
+/*
+ * the completion time is the release date of the last route that starts at its release date (the critical route)
+ * plus the time of it and of the routes after it, which start as soon as the previous one ends
+ * the routes before the critical one finish before it can start, so shortening them or moving clients between them
+ * does not change the completion time: their slack until the release date of the critical route absorbs the change
+ */
+unsigned int NeighborSearch::criticalRoute(const Solution *solution) {
+    for (int r = (int) solution->routes.size() - 1; r > 0; r--) {
+        if (solution->routeStart[r] == solution->routeRD[r]) return r;
     }
-    return time;
+    return 0;
 }
 
 // calculate the release date of the route 'r' in solution when removing 'vertex'
@@ -360,10 +467,10 @@ unsigned int NeighborSearch::routeReleaseDateRemoving(
     unsigned int rd = s->routeRD[r];
     if (RD[vertex] == rd) { // possibly removing the vertex with bigger RD in the route
         rd = 0;
-        vector<unsigned int> *route = s->routes[r];
-        for (unsigned int j = F(route); j <= L(route); j++) {
-            if (route->at(j) == vertex) continue;
-            unsigned int rdj = RD[route->at(j)];
+        const vector<unsigned int> &route = *s->routes[r];
+        for (unsigned int j = F(route); j <= route.size() - 2; j++) {
+            if (route[j] == vertex) continue;
+            unsigned int rdj = RD[route[j]];
             if (rdj > rd)
                 rd = rdj;
         }
@@ -384,40 +491,82 @@ unsigned int NeighborSearch::verifySolutionChangingRoutes(
         Solution *solution, unsigned int r1, unsigned int r2,
         unsigned int r1RD, unsigned int r1Time, unsigned int r2RD, unsigned int r2Time
 ) {
-    // calculate the ending time of the bigger route in (r1, r2)
-    unsigned int br = max(r1, r2);
-    unsigned int originalTime = solution->routeStart[br] + solution->routeTime[br];
-
-    // calculate the solution time, given the changes
-    swap(r1RD, solution->routeRD[r1]);
-    swap(r1Time, solution->routeTime[r1]);
-    swap(r2RD, solution->routeRD[r2]);
-    swap(r2Time, solution->routeTime[r2]);
-    unsigned int newTime = calculateEndingTime(solution, r1, r2);
+    if (r1 > r2) {
+        swap(r1, r2);
+        swap(r1RD, r2RD);
+        swap(r1Time, r2Time);
+    }
 
-    if (newTime >= originalTime) { // if not improved, put the values back
-        swap(r1RD, solution->routeRD[r1]);
-        swap(r1Time, solution->routeTime[r1]);
-        swap(r2RD, solution->routeRD[r2]);
-        swap(r2Time, solution->routeTime[r2]);
+    // calculate the ending time of the bigger route in (r1, r2)
+    unsigned int originalTime = solution->routeStart[r2] + solution->routeTime[r2];
+    assert(solution->getSchedule().endOf(r2) == originalTime);
 
-        return 0;
-    }
+    // calculate the ending time, given the changes
+    unsigned int newTime = solution->getSchedule().endChanging(r1, r1RD, r1Time, r2, r2RD, r2Time);
+    if (newTime >= originalTime) return 0;
 
+    solution->routeRD[r1] = r1RD;
+    solution->routeTime[r1] = r1Time;
+    solution->routeRD[r2] = r2RD;
+    solution->routeTime[r2] = r2Time;
     return originalTime - newTime;
 }
 
-vector<pair<unsigned int, unsigned int> > getRoutesPairSequence(unsigned int nRoutes) {
-    vector<pair<unsigned int, unsigned int> > sequence(nRoutes * nRoutes);
-    sequence.resize(0); // resize but keep allocated space
+// pairs of routes (i, j), i < j, in random order, with the pairs where j >= 'from' first
+void getRoutesPairSequence(vector<pair<unsigned int, unsigned int> > &sequence, unsigned int nRoutes,
+                           unsigned int from, mt19937 &generator) {
+    sequence.clear(); // keeps the allocated space
     for (unsigned int i = 0; i < nRoutes; i++) {
         for (unsigned int j = i + 1; j < nRoutes; j++) {
             sequence.emplace_back(i, j);
         }
     }
-    shuffle(sequence.begin(), sequence.end(),
-            default_random_engine(chrono::system_clock::now().time_since_epoch().count()));
-    return sequence;
+    shuffle(sequence.begin(), sequence.end(), generator);
+    if (from > 0) {
+        stable_partition(sequence.begin(), sequence.end(), [from](const pair<unsigned int, unsigned int> &p) {
+            return p.second >= from;
+        });
+    }
+}
+
+// marks the clients of the routes a and b with their positions, for the candidates of addCandidates()
+void NeighborSearch::markRoutes(const vector<unsigned int> &a, const vector<unsigned int> &b) {
+    if (routeMark.empty()) {
+        routeMark.assign(instance.nVertex(), 0);
+        positionOf.assign(instance.nVertex(), 0);
+    }
+    currentMark += 2;
+    if (currentMark < 2) { // the mark overflowed, the old marks must be cleared once
+        fill(routeMark.begin(), routeMark.end(), 0);
+        currentMark = 2;
+    }
+    for (unsigned int i = 1; i + 1 < a.size(); i++) {
+        routeMark[a[i]] = currentMark - 1;
+        positionOf[a[i]] = i;
+    }
+    for (unsigned int i = 1; i + 1 < b.size(); i++) {
+        routeMark[b[i]] = currentMark;
+        positionOf[b[i]] = i;
+    }
+}
+
+// adds the positions p + shift of the clients close to c that are at the position p of the route a (or b, inB)
+void NeighborSearch::addCandidates(unsigned int c, bool inB, int shift) {
+    if (c == 0) return; // the depot has no close clients
+    const unsigned int mark = inB ? currentMark : currentMark - 1;
+    const unsigned int *closest = instance.nearestClients(c);
+    for (unsigned int k = 0; k < instance.nNearestClients(); k++) {
+        if (routeMark[closest[k]] == mark) candidates.push_back((int) positionOf[closest[k]] + shift);
+    }
+}
+
+// keeps the candidates in [first, last], in increasing order and once each
+void NeighborSearch::sortCandidates(int first, int last) {
+    candidates.erase(remove_if(candidates.begin(), candidates.end(), [first, last](int p) {
+        return p < first || p > last;
+    }), candidates.end());
+    sort(candidates.begin(), candidates.end());
+    candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
 }
 
 unsigned int NeighborSearch::vertexRelocation(Solution *solution) {
@@ -425,7 +574,8 @@ unsigned int NeighborSearch::vertexRelocation(Solution *solution) {
     unsigned int gain;
     do {
         gain = 0;
-        for (auto &routePair: getRoutesPairSequence(solution->routes.size())) {
+        getRoutesPairSequence(routePairs, solution->routes.size(), firstRoute(solution), generator);
+        for (auto &routePair: routePairs) {
             auto &r1 = routePair.first;
             auto &r2 = routePair.second;
             unsigned int gainIt;
@@ -440,21 +590,24 @@ unsigned int NeighborSearch::vertexRelocation(Solution *solution) {
     return originalTime - solution->time;
 }
 
-unsigned int NeighborSearch::vertexRelocationIt(Solution *solution, unsigned int r1, unsigned int r2) {
+template<class Matrix>
+unsigned int NeighborSearch::vertexRelocationIt(Solution *solution, unsigned int r1, unsigned int r2,
+                                                const Matrix &matrix) {
     vector<unsigned int> *route1 = solution->routes[r1];
     vector<unsigned int> *route2 = solution->routes[r2];
+    const RouteView view1(*route1, W, arcsBuffer1), view2(*route2, W, arcsBuffer2);
+    if (granular<Matrix>()) markRoutes(*route1, *route2);
 
     // try to remove a vertex from r2 and put in r1
-    for (unsigned int i = F(route2); i <= L(route2); i++) {
-        unsigned int vertex = route2->at(i);
+    for (unsigned int i = view2.first(); i <= view2.last(); i++) {
+        unsigned int vertex = view2[i];
 
         // check the new release date of route2 when removing 'vertex'
         unsigned int r2RD = routeReleaseDateRemoving(solution, r2, vertex);
 
         // calculate the new route time of route2 when removing vertex
-        unsigned int r2Time = solution->routeTime[r2]
-                              - W[route2->at(i - 1)][route2->at(i)] - W[route2->at(i)][route2->at(i + 1)]
-                              + W[route2->at(i - 1)][route2->at(i + 1)];
+        unsigned int r2Time = solution->routeTime[r2] - view2.arc(i - 1) - view2.arc(i)
+                              + matrix[view2[i - 1]][view2[i + 1]];
 
         // check release date of route1, when inserting 'vertex'
         unsigned int r1RD = max(solution->routeRD[r1], RD[vertex]);
@@ -462,18 +615,31 @@ unsigned int NeighborSearch::vertexRelocationIt(Solution *solution, unsigned int
         // check where to put vertex to have the smaller route time
         unsigned int r1Time = numeric_limits<unsigned int>::max();
         unsigned int bestJ;
-        for (unsigned int j = 0; j < route1->size() - 1; j++) {
-            unsigned int time = solution->routeTime[r1]
-                                - W[route1->at(j)][route1->at(j + 1)]
-                                + W[route1->at(j)][vertex] + W[vertex][route1->at(j + 1)];
+        const auto fromVertex = matrix[vertex];
+        auto insertAfter = [&](unsigned int j) {
+            unsigned int time = solution->routeTime[r1] - view1.arc(j)
+                                + matrix[view1[j]][vertex] + fromVertex[view1[j + 1]];
             if (time < r1Time) {
                 r1Time = time;
                 bestJ = j;
             }
+        };
+        if (granular<Matrix>()) { // next to the clients close to vertex
+            candidates.clear();
+            addCandidates(vertex, false, 0);
+            addCandidates(vertex, false, -1);
+            sortCandidates(0, (int) view1.size() - 2);
+            if (candidates.empty()) continue;
+            evaluations += candidates.size();
+            for (int j: candidates) insertAfter(j);
+        } else {
+            evaluations += view1.size() - 1;
+            for (unsigned int j = 0; j < view1.size() - 1; j++) insertAfter(j);
         }
 
         unsigned int routeGain = verifySolutionChangingRoutes(solution, r1, r2, r1RD, r1Time, r2RD, r2Time);
         if (routeGain > 0) { // perform the movement
+            moves++;
             route2->erase(route2->begin() + i); // delete i-th element
             route1->insert(route1->begin() + bestJ + 1, vertex);
             solution->updateStartingTimes(min(r1, r2));
@@ -485,12 +651,17 @@ unsigned int NeighborSearch::vertexRelocationIt(Solution *solution, unsigned int
     return 0;
 }
 
+unsigned int NeighborSearch::vertexRelocationIt(Solution *solution, unsigned int r1, unsigned int r2) {
+    return W.isDense() ? vertexRelocationIt(solution, r1, r2, W.dense()) : vertexRelocationIt(solution, r1, r2, W);
+}
+
 unsigned int NeighborSearch::interSwap(Solution *solution) {
     const unsigned int originalTime = solution->time;
     unsigned int gain;
     do {
         gain = 0;
-        for (auto &routePair: getRoutesPairSequence(solution->routes.size())) {
+        getRoutesPairSequence(routePairs, solution->routes.size(), firstRoute(solution), generator);
+        for (auto &routePair: routePairs) {
             unsigned int gainIt;
             do {
                 gainIt = interSwapIt(solution, routePair.first, routePair.second);
@@ -501,49 +672,73 @@ unsigned int NeighborSearch::interSwap(Solution *solution) {
     return originalTime - solution->time;
 }
 
-unsigned int NeighborSearch::interSwapIt(Solution *solution, unsigned int r1, unsigned int r2) {
+template<class Matrix>
+unsigned int NeighborSearch::interSwapIt(Solution *solution, unsigned int r1, unsigned int r2, const Matrix &matrix) {
     vector<unsigned int> *route1 = solution->routes[r1];
     vector<unsigned int> *route2 = solution->routes[r2];
+    const RouteView view1(*route1, W, arcsBuffer1), view2(*route2, W, arcsBuffer2);
+    if (granular<Matrix>()) markRoutes(*route1, *route2);
 
     // try to swap the i-th vertex from r1 with the j-th vertex from r2
-    for (int i = F(route1); i <= (int) L(route1); i++) {
-        const unsigned int vertex1 = route1->at(i);
+    for (unsigned int i = view1.first(); i <= view1.last(); i++) {
+        const unsigned int vertex1 = view1[i];
+        const unsigned int previous1 = view1[i - 1], next1 = view1[i + 1];
+        const auto fromVertex1 = matrix[vertex1];
 
         // check the new release date of route1 when removing 'vertex1'
         const unsigned int preR1RD = routeReleaseDateRemoving(solution, r1, vertex1);
 
         // time of the route without the arcs with vertex1
-        const unsigned int preR1Time = solution->routeTime[r1]
-                                       - W[route1->at(i - 1)][vertex1] - W[vertex1][route1->at(i + 1)];
+        const unsigned int preR1Time = solution->routeTime[r1] - view1.arc(i - 1) - view1.arc(i);
 
-
-        // check where to put vertex to have the smaller route time
-        for (unsigned int j = F(route2); j <= L(route2); j++) {
-            const unsigned int vertex2 = route2->at(j);
+        // the gain of swapping vertex1 with the j-th vertex of r2, applied if positive
+        auto swapWith = [&](unsigned int j) {
+            const unsigned int vertex2 = view2[j];
             const unsigned int r1RD = max(RD[vertex2], preR1RD);
-            const unsigned int r1Time = preR1Time
-                                        + W[route1->at(i - 1)][vertex2] + W[vertex2][route1->at(i + 1)];
+            const unsigned int r1Time = preR1Time + matrix[previous1][vertex2] + matrix[vertex2][next1];
 
             unsigned int r2RD = routeReleaseDateRemoving(solution, r2, vertex2); // removing vertex2
             r2RD = max(r2RD, RD[vertex1]); // inserting vertex1
-            const unsigned int r2Time = solution->routeTime[r2]
-                                        - W[route2->at(j - 1)][vertex2] - W[vertex2][route2->at(j + 1)]
-                                        + W[route2->at(j - 1)][vertex1] + W[vertex1][route2->at(j + 1)];
+            const unsigned int r2Time = solution->routeTime[r2] - view2.arc(j - 1) - view2.arc(j)
+                                        + matrix[view2[j - 1]][vertex1] + fromVertex1[view2[j + 1]];
 
             const unsigned int routeGain = verifySolutionChangingRoutes(solution, r1, r2, r1RD, r1Time, r2RD, r2Time);
+            evaluations++;
             if (routeGain > 0) { // perform movement
+                moves++;
                 swap(route1->at(i), route2->at(j));
                 solution->updateStartingTimes(min(r1, r2));
-                return routeGain;
             }
-
+            return routeGain;
+        };
+
+        if (granular<Matrix>()) {
+            // vertex1 next to the clients close to it, or the clients close to its neighbors in its place
+            candidates.clear();
+            addCandidates(vertex1, true, -1);
+            addCandidates(vertex1, true, 1);
+            addCandidates(previous1, true, 0);
+            addCandidates(next1, true, 0);
+            sortCandidates((int) view2.first(), (int) view2.last());
+            for (int j: candidates) {
+                const unsigned int routeGain = swapWith(j);
+                if (routeGain > 0) return routeGain;
+            }
+        } else {
+            for (unsigned int j = view2.first(); j <= view2.last(); j++) {
+                const unsigned int routeGain = swapWith(j);
+                if (routeGain > 0) return routeGain;
+            }
         }
-
     }
 
     return 0;
 }
 
+unsigned int NeighborSearch::interSwapIt(Solution *solution, unsigned int r1, unsigned int r2) {
+    return W.isDense() ? interSwapIt(solution, r1, r2, W.dense()) : interSwapIt(solution, r1, r2, W);
+}
+
 unsigned int NeighborSearch::insertDepotAndReorder(Solution *solution) {
     unsigned int originalTime = solution->time;
     bool improved;
@@ -575,13 +770,16 @@ bool NeighborSearch::insertDepotAndReorderIt(Solution *s) {
         }
 
 
-        vector<unsigned int> totalTimeForward(route->size()); // total time of going from the depot to the i-th element
+        vector<unsigned int> &totalTimeForward = timeForward; // total time of going from the depot to the i-th element
+        totalTimeForward.resize(route->size());
         totalTimeForward[0] = W[0][route->at(0)];
         for (unsigned int i = 1; i < route->size(); i++)
             totalTimeForward[i] = totalTimeForward[i - 1] + W[route->at(i - 1)][route->at(i)];
 
-        vector<unsigned int> totalTimeBack(route->size()); // total time of going from the i-th element to the depot
-        vector<unsigned int> maxRDBack(route->size()); // max RD between all element from i to the end
+        vector<unsigned int> &totalTimeBack = timeBack; // total time of going from the i-th element to the depot
+        vector<unsigned int> &maxRDBack = rdBack; // max RD between all element from i to the end
+        totalTimeBack.resize(route->size());
+        maxRDBack.resize(route->size());
         totalTimeBack.back() = W[route->back()][0];
         maxRDBack.back() = RD[route->back()];
         for (int i = (int) route->size() - 2; i >= 0; i--) {
@@ -598,6 +796,7 @@ bool NeighborSearch::insertDepotAndReorderIt(Solution *s) {
 
             // check if the time improve if we change the original route r(1, N) to the routes r(i+1, N) and R(1, i)
             unsigned int time = max(s->routeStart[r - 1] + s->routeTime[r - 1], rd2); // starting time of first route
+            evaluations++;
             time += time2; // ending time of the first route
             time = max(time, rd1); // starting time of the second route
             time += time1; // ending time of the second route
@@ -611,15 +810,16 @@ bool NeighborSearch::insertDepotAndReorderIt(Solution *s) {
                 s->routeStart.push_back(0); // only increase the size to update after
 
                 // update routes
-                // move 1 element more in the beginning to change to the depot
-                s->routes.insert(s->routes.begin() + r, new vector<unsigned int>(make_move_iterator(route->begin() + i),
-                                                                                 make_move_iterator(route->end())));
+                // copy 1 element more in the beginning to change to the depot
+                vector<unsigned int> *second = s->newRoute();
+                second->assign(route->begin() + i, route->end());
+                s->routes.insert(s->routes.begin() + r, second);
 
-                s->routes[r + 1]->at(i) = s->routes[r]->at(0); // restore the moved element
-                s->routes[r]->at(0) = 0; // change moved element to depot
+                s->routes[r]->at(0) = 0; // change copied element to depot
                 s->routes[r + 1]->at(i + 1) = 0; // end depot
                 s->routes[r + 1]->resize(i + 2); // new route size after moving
                 s->updateStartingTimes(r);
+                moves++;
 
                 return true;
             }
@@ -629,41 +829,495 @@ bool NeighborSearch::insertDepotAndReorderIt(Solution *s) {
     return false;
 }
 
+PairSchedule NeighborSearch::pairSchedule(Solution *solution, unsigned int lo, unsigned int hi) {
+    PairSchedule schedule{};
+    schedule.previousEnd = lo == 0 ? 0 : solution->routeStart[lo - 1] + solution->routeTime[lo - 1];
+    // the routes between lo and hi end at max(t + midTime, midEnd) when they can start at t
+    const MaxPlus mid = solution->getSchedule().range(lo + 1, (int) hi - 1);
+    schedule.midTime = mid.A;
+    schedule.midEnd = mid.B;
+    schedule.originalEnd = solution->routeStart[hi] + solution->routeTime[hi];
+    return schedule;
+}
+
+// max release date of the n clients starting at the i-th position
+unsigned int NeighborSearch::segmentRD(const vector<unsigned int> &route, unsigned int i, unsigned int n) const {
+    unsigned int rd = 0;
+    for (unsigned int k = i; k < i + n; k++) rd = max(rd, RD[route[k]]);
+    return rd;
+}
+
+// applies the given search to each pair of routes until no pair improves
+unsigned int NeighborSearch::interRouteSearch(
+        Solution *solution, unsigned int (NeighborSearch::*searchIt)(Solution *, unsigned int, unsigned int)
+) {
+    const unsigned int originalTime = solution->time;
+    unsigned int gain;
+    do {
+        gain = 0;
+        getRoutesPairSequence(routePairs, solution->routes.size(), firstRoute(solution), generator);
+        for (auto &routePair: routePairs) {
+            unsigned int gainIt;
+            do {
+                gainIt = (this->*searchIt)(solution, routePair.first, routePair.second);
+                gain += gainIt;
+            } while (gainIt > 0);
+        }
+    } while (gain > 0);
+    solution->removeEmptyRoutes();
+    return originalTime - solution->time;
+}
+
+/*
+ * Or-opt: moves a segment of up to maxSegment clients from a route of the pair to a position of the other one,
+ * keeping its orientation
+ */
+template<class Matrix>
+unsigned int NeighborSearch::orOptIt(Solution *solution, unsigned int r1, unsigned int r2, const Matrix &matrix) {
+    const unsigned int lo = min(r1, r2), hi = max(r1, r2);
+    const PairSchedule schedule = pairSchedule(solution, lo, hi);
+    cache1.build(*solution->routes[lo], W, RD);
+    cache2.build(*solution->routes[hi], W, RD);
+    if (granular<Matrix>()) markRoutes(*solution->routes[lo], *solution->routes[hi]);
+
+    InterMove best{};
+    best.end = schedule.originalEnd;
+    for (unsigned int fromLo = 0; fromLo < 2; fromLo++) {
+        const unsigned int rFrom = fromLo ? lo : hi, rTo = fromLo ? hi : lo;
+        const vector<unsigned int> &from = *solution->routes[rFrom], &to = *solution->routes[rTo];
+        const RouteCache &cacheFrom = fromLo ? cache1 : cache2, &cacheTo = fromLo ? cache2 : cache1;
+
+        for (unsigned int n = 1; n <= options.maxSegment; n++) {
+            for (unsigned int i = 1; i + n < from.size(); i++) {
+                const unsigned int first = from[i], last = from[i + n - 1];
+                const auto fromLast = matrix[last];
+                const unsigned int segmentTime = cacheFrom.path(i, i + n - 1);
+
+                // the route without the segment, and the release date of the other route with it
+                const unsigned int fromTime = solution->routeTime[rFrom] - cacheFrom.path(i - 1, i + n)
+                                              + matrix[from[i - 1]][from[i + n]];
+                const unsigned int fromRD = max(cacheFrom.rdUntil(i - 1), cacheFrom.rdFrom(i + n));
+                const unsigned int toRD = max(solution->routeRD[rTo], segmentRD(from, i, n));
+
+                // keeps the insertion after the j-th vertex if it is the best move, true to apply it now
+                auto insertAfter = [&](unsigned int j) {
+                    const unsigned int toTime = solution->routeTime[rTo] - cacheTo.path(j, j + 1)
+                                                + matrix[to[j]][first] + segmentTime + fromLast[to[j + 1]];
+                    const unsigned int end = fromLo ? schedule.endTime(fromRD, fromTime, toRD, toTime)
+                                                    : schedule.endTime(toRD, toTime, fromRD, fromTime);
+                    if (end >= best.end) return false;
+                    if (fromLo) best = {end, fromRD, fromTime, toRD, toTime, true, i, n, j, 0};
+                    else best = {end, toRD, toTime, fromRD, fromTime, false, i, n, j, 0};
+                    return !options.bestImprovement;
+                };
+
+                bool applyNow = false;
+                if (granular<Matrix>()) {
+                    // the segment after a client close to its first one, or before a client close to its last one
+                    candidates.clear();
+                    addCandidates(first, fromLo, 0);
+                    addCandidates(last, fromLo, -1);
+                    sortCandidates(0, (int) to.size() - 2);
+                    evaluations += candidates.size();
+                    for (unsigned int k = 0; k < candidates.size() && !applyNow; k++) {
+                        applyNow = insertAfter(candidates[k]);
+                    }
+                } else {
+                    evaluations += to.size() - 1;
+                    for (unsigned int j = 0; j + 1 < to.size() && !applyNow; j++) applyNow = insertAfter(j);
+                }
+                if (applyNow) {
+                    applyOrOpt(solution, lo, hi, best);
+                    return applyInterMove(solution, lo, hi, best, schedule);
+                }
+            }
+        }
+    }
+
+    if (best.end == schedule.originalEnd) return 0;
+    applyOrOpt(solution, lo, hi, best);
+    return applyInterMove(solution, lo, hi, best, schedule);
+}
+
+unsigned int NeighborSearch::orOptIt(Solution *solution, unsigned int r1, unsigned int r2) {
+    return W.isDense() ? orOptIt(solution, r1, r2, W.dense()) : orOptIt(solution, r1, r2, W);
+}
+
+void NeighborSearch::applyOrOpt(Solution *solution, unsigned int lo, unsigned int hi, const InterMove &move) {
+    vector<unsigned int> &from = *solution->routes[move.fromLo ? lo : hi];
+    vector<unsigned int> &to = *solution->routes[move.fromLo ? hi : lo];
+    to.insert(to.begin() + move.j + 1, from.begin() + move.i, from.begin() + move.i + move.n);
+    from.erase(from.begin() + move.i, from.begin() + move.i + move.n);
+}
+
+/*
+ * 2-opt*: exchanges the tails of the two routes, the route lo keeps its vertices until the i-th and continues with
+ * the vertices of the route hi after the j-th, and vice versa
+ */
+template<class Matrix>
+unsigned int NeighborSearch::twoOptStarIt(Solution *solution, unsigned int r1, unsigned int r2,
+                                          const Matrix &matrix) {
+    const unsigned int lo = min(r1, r2), hi = max(r1, r2);
+    const PairSchedule schedule = pairSchedule(solution, lo, hi);
+    const vector<unsigned int> &a = *solution->routes[lo], &b = *solution->routes[hi];
+    cache1.build(a, W, RD);
+    cache2.build(b, W, RD);
+    if (granular<Matrix>()) markRoutes(a, b);
+
+    InterMove best{};
+    best.end = schedule.originalEnd;
+    if (!granular<Matrix>()) evaluations += (a.size() - 1) * (b.size() - 1) - 1;
+    for (unsigned int i = 0; i + 1 < a.size(); i++) {
+        const auto fromA = matrix[a[i]];
+
+        // keeps the exchange of the tails after a[i] and b[j] if it is the best move, true to apply it now
+        auto exchangeAfter = [&](unsigned int j) {
+            if (i + 2 == a.size() && j + 2 == b.size()) return false; // both tails are only the depot
+
+            const unsigned int loTime = cache1.path(0, i) + fromA[b[j + 1]] + cache2.pathToEnd(j + 1);
+            const unsigned int loRD = max(cache1.rdUntil(i), cache2.rdFrom(j + 1));
+            const unsigned int hiTime = cache2.path(0, j) + matrix[b[j]][a[i + 1]] + cache1.pathToEnd(i + 1);
+            const unsigned int hiRD = max(cache2.rdUntil(j), cache1.rdFrom(i + 1));
+            const unsigned int end = schedule.endTime(loRD, loTime, hiRD, hiTime);
+            if (end >= best.end) return false;
+            best = {end, loRD, loTime, hiRD, hiTime, false, i, 0, j, 0};
+            return !options.bestImprovement;
+        };
+
+        bool applyNow = false;
+        if (granular<Matrix>()) { // a[i] followed by a client close to it, or a[i + 1] preceded by one
+            candidates.clear();
+            addCandidates(a[i], true, -1);
+            addCandidates(a[i + 1], true, 0);
+            sortCandidates(0, (int) b.size() - 2);
+            evaluations += candidates.size();
+            for (unsigned int k = 0; k < candidates.size() && !applyNow; k++) {
+                applyNow = exchangeAfter(candidates[k]);
+            }
+        } else {
+            for (unsigned int j = 0; j + 1 < b.size() && !applyNow; j++) applyNow = exchangeAfter(j);
+        }
+        if (applyNow) {
+            applyTwoOptStar(solution, lo, hi, best);
+            return applyInterMove(solution, lo, hi, best, schedule);
+        }
+    }
+
+    if (best.end == schedule.originalEnd) return 0;
+    applyTwoOptStar(solution, lo, hi, best);
+    return applyInterMove(solution, lo, hi, best, schedule);
+}
+
+unsigned int NeighborSearch::twoOptStarIt(Solution *solution, unsigned int r1, unsigned int r2) {
+    return W.isDense() ? twoOptStarIt(solution, r1, r2, W.dense()) : twoOptStarIt(solution, r1, r2, W);
+}
+
+void NeighborSearch::applyTwoOptStar(Solution *solution, unsigned int lo, unsigned int hi, const InterMove &move) {
+    vector<unsigned int> &a = *solution->routes[lo], &b = *solution->routes[hi];
+    vector<unsigned int> &tailA = moveBuffer;
+    tailA.assign(a.begin() + move.i + 1, a.end());
+    a.resize(move.i + 1);
+    a.insert(a.end(), b.begin() + move.j + 1, b.end());
+    b.resize(move.j + 1);
+    b.insert(b.end(), tailA.begin(), tailA.end());
+}
+
+/*
+ * segment swap: exchanges a segment of up to maxSegment clients of the route lo with a segment of up to maxSegment
+ * clients of the route hi, keeping their orientation
+ */
+template<class Matrix>
+unsigned int NeighborSearch::segmentSwapIt(Solution *solution, unsigned int r1, unsigned int r2,
+                                           const Matrix &matrix) {
+    const unsigned int lo = min(r1, r2), hi = max(r1, r2);
+    const PairSchedule schedule = pairSchedule(solution, lo, hi);
+    const vector<unsigned int> &a = *solution->routes[lo], &b = *solution->routes[hi];
+    cache1.build(a, W, RD);
+    cache2.build(b, W, RD);
+    if (granular<Matrix>()) markRoutes(a, b);
+
+    InterMove best{};
+    best.end = schedule.originalEnd;
+    for (unsigned int n = 1; n <= options.maxSegment; n++) {
+        for (unsigned int i = 1; i + n < a.size(); i++) {
+            // the route lo without the segment [i, i + n - 1]
+            const unsigned int aPrevious = a[i - 1], aNext = a[i + n], aFirst = a[i], aLast = a[i + n - 1];
+            const unsigned int aTime = solution->routeTime[lo] - cache1.path(i - 1, i + n);
+            const unsigned int aSegmentTime = cache1.path(i, i + n - 1);
+            const unsigned int aRD = max(cache1.rdUntil(i - 1), cache1.rdFrom(i + n));
+            const unsigned int aSegmentRD = segmentRD(a, i, n);
+
+            for (unsigned int m = 1; m <= options.maxSegment; m++) {
+                if (b.size() < m + 2) break;
+
+                // keeps the swap with the segment [j, j + m - 1] of b if it is the best move, true to apply it now
+                auto swapWith = [&](unsigned int j) {
+                    const unsigned int bFirst = b[j], bLast = b[j + m - 1];
+                    const unsigned int loTime = aTime + matrix[aPrevious][bFirst] + cache2.path(j, j + m - 1)
+                                                + matrix[bLast][aNext];
+                    const unsigned int loRD = max(aRD, segmentRD(b, j, m));
+                    const unsigned int hiTime = solution->routeTime[hi] - cache2.path(j - 1, j + m)
+                                                + matrix[b[j - 1]][aFirst] + aSegmentTime + matrix[aLast][b[j + m]];
+                    const unsigned int hiRD = max(max(cache2.rdUntil(j - 1), cache2.rdFrom(j + m)), aSegmentRD);
+                    const unsigned int end = schedule.endTime(loRD, loTime, hiRD, hiTime);
+                    if (end >= best.end) return false;
+                    best = {end, loRD, loTime, hiRD, hiTime, false, i, n, j, m};
+                    return !options.bestImprovement;
+                };
+
+                bool applyNow = false;
+                if (granular<Matrix>()) { // one of the four new arcs joins a client of a to a client close to it
+                    candidates.clear();
+                    addCandidates(aPrevious, true, 0);
+                    addCandidates(aNext, true, 1 - (int) m);
+                    addCandidates(aFirst, true, 1);
+                    addCandidates(aLast, true, -(int) m);
+                    sortCandidates(1, (int) (b.size() - m) - 1);
+                    evaluations += candidates.size();
+                    for (unsigned int k = 0; k < candidates.size() && !applyNow; k++) {
+                        applyNow = swapWith(candidates[k]);
+                    }
+                } else {
+                    evaluations += b.size() - m - 1;
+                    for (unsigned int j = 1; j + m < b.size() && !applyNow; j++) applyNow = swapWith(j);
+                }
+                if (applyNow) {
+                    applySegmentSwap(solution, lo, hi, best);
+                    return applyInterMove(solution, lo, hi, best, schedule);
+                }
+            }
+        }
+    }
+
+    if (best.end == schedule.originalEnd) return 0;
+    applySegmentSwap(solution, lo, hi, best);
+    return applyInterMove(solution, lo, hi, best, schedule);
+}
+
+unsigned int NeighborSearch::segmentSwapIt(Solution *solution, unsigned int r1, unsigned int r2) {
+    return W.isDense() ? segmentSwapIt(solution, r1, r2, W.dense()) : segmentSwapIt(solution, r1, r2, W);
+}
+
+void NeighborSearch::applySegmentSwap(Solution *solution, unsigned int lo, unsigned int hi, const InterMove &move) {
+    vector<unsigned int> &a = *solution->routes[lo], &b = *solution->routes[hi];
+    vector<unsigned int> &segmentA = moveBuffer;
+    segmentA.assign(a.begin() + move.i, a.begin() + move.i + move.n);
+    a.erase(a.begin() + move.i, a.begin() + move.i + move.n);
+    a.insert(a.begin() + move.i, b.begin() + move.j, b.begin() + move.j + move.m);
+    b.erase(b.begin() + move.j, b.begin() + move.j + move.m);
+    b.insert(b.begin() + move.j, segmentA.begin(), segmentA.end());
+}
+
+// updates the release dates and times of the routes changed by a segment operator, returns the gain
+unsigned int NeighborSearch::applyInterMove(
+        Solution *solution, unsigned int lo, unsigned int hi, const InterMove &move, const PairSchedule &schedule
+) {
+    moves++;
+    solution->routeRD[lo] = move.loRD;
+    solution->routeTime[lo] = move.loTime;
+    solution->routeRD[hi] = move.hiRD;
+    solution->routeTime[hi] = move.hiTime;
+    solution->updateStartingTimes(lo);
+    assert(solution->routeStart[hi] + solution->routeTime[hi] == move.end);
+    return schedule.originalEnd - move.end;
+}
+
 unsigned int NeighborSearch::splitNs(Solution *solution) {
-    Sequence *sequence = solution->toSequence();
-    set<unsigned int> depotVisits;
-    unsigned int splitTime = Split::split(depotVisits, instance.getW(), instance.getRD(), *sequence);
+    const Sequence &sequence = solution->getSequence();
+    unsigned int splitTime = splitEngine.split(sequence, splitEnds);
+    splits++;
 
     unsigned int gain = 0;
     if (splitTime < solution->time) {
+        moves++;
         gain = solution->time - splitTime;
-        Solution newSolution(instance, *sequence, &depotVisits);
-        solution->mirror(&newSolution);
+        solution->assign(sequence, splitEnds);
     }
-    delete sequence;
     return gain;
 }
 
-unsigned int NeighborSearch::educate(Solution *solution) {
+/*
+ * Local search on the giant tour of the solution: relocate, swap and 2-opt moves between positions at most
+ * giantTourWindow apart, each evaluated by the completion time of the best split of the changed tour, so the moves
+ * also choose where the routes end
+ *
+ * the split engine evaluates a move exactly, from the labels of the current tour before it and the best completions of
+ * the clients after it, so its cost depends on the size of the move, not of the tour; the first improving move is split
+ * again and applied, and the scan goes on until a whole pass does not improve
+ */
+unsigned int NeighborSearch::giantTourSearch(Solution *solution) {
+    tour = solution->getSequence();
+    const unsigned int N = tour.size();
+    unsigned int bestTime = splitEngine.split(tour, splitEnds);
+    splits++;
+
+    bool improved = true;
+    while (improved) {
+        improved = false;
+        for (int a = (int) N - 2; a >= 0; a--) {
+            const auto first = tour.begin() + a;
+            const unsigned int last = min(N - 1, a + options.giantTourWindow);
+            for (unsigned int b = a + 1; b <= last; b++) {
+                const auto end = tour.begin() + b + 1;
+                // swap (the same as the relocations and the 2-opt when b = a + 1)
+                swap(tour[a], tour[b]);
+                if (keepTourMove(a, b + 1, bestTime)) {
+                    improved = true;
+                    continue;
+                }
+                swap(tour[a], tour[b]);
+                if (b == (unsigned int) a + 1) continue;
+
+                // the client at a moves to b
+                rotate(first, first + 1, end);
+                if (keepTourMove(a, b + 1, bestTime)) {
+                    improved = true;
+                    continue;
+                }
+                rotate(first, end - 1, end);
+
+                // the client at b moves to a
+                rotate(first, end - 1, end);
+                if (keepTourMove(a, b + 1, bestTime)) {
+                    improved = true;
+                    continue;
+                }
+                rotate(first, first + 1, end);
+
+                // 2-opt: the clients a..b are reversed
+                reverse(first, end);
+                if (keepTourMove(a, b + 1, bestTime)) {
+                    improved = true;
+                    continue;
+                }
+                reverse(first, end);
+            }
+        }
+    }
+
+    unsigned int gain = 0;
+    if (bestTime < solution->time) {
+        moves++;
+        gain = solution->time - bestTime;
+        solution->assign(tour, splitEnds);
+    }
+    return gain;
+}
+
+// keeps the move just made on the giant tour, which changed the positions from..to-1, if it improves the split
+bool NeighborSearch::keepTourMove(unsigned int from, unsigned int to, unsigned int &bestTime) {
+    evaluations++;
+    const unsigned int time = splitEngine.evaluate(tour, from, to);
+#ifdef TSPRD_CHECK
+    vector<unsigned int> ends;
+    if (time != min(bestTime, Split::split(ends, W, RD, tour))) {
+        cout << "ERROR split_evaluation " << from << " " << to << endl;
+        exit(1);
+    }
+#endif
+    if (time >= bestTime) return false;
+    bestTime = splitEngine.split(tour, splitEnds);
+    splits++;
+    moves++;
+    return true;
+}
+
+// with 'all', the routes that cannot change the completion time are also improved
+unsigned int NeighborSearch::educate(Solution *solution, bool all) {
     const unsigned int originalTime = solution->time;
+#ifdef TSPRD_PROFILE
+    const auto start = chrono::steady_clock::now();
+    const unsigned long long evaluationsBefore = evaluations, movesBefore = moves;
+#endif
 
-    intraSearch(solution, true);
+    intraSearch(solution, true); // the routes before the critical one are still part of the genes of the solution
     int which = 1; // 0: intraSearch   1: interSearch
     bool splitImproved = false;
     do {
         bool improved;
         do {
             if (which == 0) {
-                improved = intraSearch(solution) > 0;
+                improved = intraSearch(solution, all) > 0;
             } else {
-                improved = interSearch(solution) > 0;
+                improved = interSearch(solution, all) > 0;
             }
             which = 1 - which;
         } while (improved);
 
-        if (applySplit)
-            splitImproved = splitNs(solution) > 0;
+        if (applySplit) {
+#ifdef TSPRD_PROFILE
+            const auto splitStart = chrono::steady_clock::now();
+            const unsigned long long splitMovesBefore = moves;
+            const unsigned int gain = options.giantTourSearch ? giantTourSearch(solution) : splitNs(solution);
+            recordStats(operatorStats[SPLIT_OPERATOR], splitStart, evaluations, splitMovesBefore, gain);
+            splitImproved = gain > 0;
+#else
+            splitImproved = (options.giantTourSearch ? giantTourSearch(solution) : splitNs(solution)) > 0;
+#endif
+        }
     } while (splitImproved);
 
+#ifdef TSPRD_PROFILE
+    recordStats(educateStats, start, evaluationsBefore, movesBefore, originalTime - solution->time);
+#endif
     return originalTime - solution->time;
+}
+
+#ifdef TSPRD_PROFILE
+void NeighborSearch::recordStats(
+        OperatorStats &stats, chrono::steady_clock::time_point start, unsigned long long evaluationsBefore,
+        unsigned long long movesBefore, unsigned int gain
+) {
+    stats.calls++;
+    stats.evaluations += evaluations - evaluationsBefore;
+    stats.moves += moves - movesBefore;
+    stats.gain += gain;
+    stats.nanoseconds += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+}
+#endif
+
+const char *NeighborSearch::operatorName(unsigned int op) {
+    static const char *names[] = {"swap(1,1)", "swap(1,2)", "swap(2,2)", "reinsertion(1)", "reinsertion(2)",
+                                  "twoOpt", "vertexRelocation", "interSwap", "insertDepotAndReorder", "orOpt", "twoOptStar",
+                                  "segmentSwap", "split"};
+    return names[op];
+}
+
+// writes one line per operator, and one for the whole education, with the collected statistics
+void NeighborSearch::printStats(ostream &out) const {
+#ifdef TSPRD_PROFILE
+    char buffer[200];
+    sprintf(buffer, "%-22s %10s %14s %10s %12s %12s %12s", "operator", "calls", "evaluations", "moves", "gain",
+            "time(ms)", "gain/ms");
+    out << buffer << endl;
+    for (unsigned int op = 0; op <= operatorStats.size(); op++) {
+        const OperatorStats &stats = op < operatorStats.size() ? operatorStats[op] : educateStats;
+        const double ms = stats.nanoseconds / 1e6;
+        sprintf(buffer, "%-22s %10llu %14llu %10llu %12llu %12.2f %12.2f",
+                op < operatorStats.size() ? operatorName(op) : "educate", stats.calls, stats.evaluations,
+                stats.moves, stats.gain, ms, ms > 0 ? stats.gain / ms : 0.0);
+        out << buffer << endl;
+    }
+#else
+    out << "compile with TSPRD_PROFILE to collect the neighbor search statistics" << endl;
+#endif
+    if (options.adaptiveOrder) {
+        out << endl << "operator weights" << endl;
+        for (auto &weight: getOperatorWeights()) {
+            out << weight.first << " " << weight.second << endl;
+        }
+    }
+}
+
+// current weights of the adaptive order, per operator name
+vector<pair<string, double> > NeighborSearch::getOperatorWeights() const {
+    vector<pair<string, double> > weights;
+    for (unsigned int k = 0; k < intraScheduler.getOperators().size(); k++) {
+        weights.emplace_back(operatorName(intraScheduler.getOperators()[k] - 1), intraScheduler.getWeights()[k]);
+    }
+    for (unsigned int k = 0; k < interScheduler.getOperators().size(); k++) {
+        weights.emplace_back(operatorName(INTRA_OPERATORS + interScheduler.getOperators()[k] - 1),
+                             interScheduler.getWeights()[k]);
+    }
+    return weights;
 }
\ No newline at end of file
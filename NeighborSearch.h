@@ -2,48 +2,215 @@
 #define TSPRD_NEIGHBORSEARCH_H
 
 #include <random>
+#include <chrono>
+#include <ostream>
+#include <type_traits>
 #include "Instance.h"
 #include "Solution.h"
+#include "Random.h"
+#include "RouteView.h"
+#include "OperatorScheduler.h"
+#include "Split.h"
+
+// statistics of a neighborhood operator (or of the whole education)
+// collected only when compiled with TSPRD_PROFILE, so the default build pays nothing for them
+struct OperatorStats {
+    unsigned long long calls = 0;
+    unsigned long long evaluations = 0; // moves evaluated
+    unsigned long long moves = 0; // improving moves applied
+    unsigned long long gain = 0; // sum of the gains, in route time for intra and completion time for inter operators
+    unsigned long long nanoseconds = 0;
+};
+
+// configuration of the neighbor search
+struct SearchOptions {
+    // use orOpt and segmentSwap (which generalize vertexRelocation and interSwap) and twoOptStar in the inter search
+    bool segmentOperators = true;
+    // in the segment operators, apply the best move of a pair of routes (true) or the first improving one (false)
+    bool bestImprovement = true;
+    unsigned int maxSegment = 3; // longest segment moved by orOpt and segmentSwap
+
+    // order in which the operators are tried: drawn by the weights of an OperatorScheduler (true) or uniformly
+    bool adaptiveOrder = true;
+    // cost of an operator call for the weights: time (microseconds) or move evaluations, which keep runs deterministic
+    bool timeCost = false;
+    double reaction = 0.1; // how much the weights follow the last segment
+    unsigned int segment = 100; // operator calls between the updates of the weights
+
+    // replace the split of the education by a local search on the giant tour, see giantTourSearch()
+    bool giantTourSearch = false;
+    unsigned int giantTourWindow = 8; // farthest position a client is moved to by the giant tour moves
+};
+
+// ending time of the routes [lo, hi] when only the routes lo and hi change
+// the routes between them are composed in a single function max(t + midTime, midEnd), so each evaluation is O(1)
+struct PairSchedule {
+    unsigned int previousEnd; // ending time of the route lo - 1
+    unsigned int midTime = 0, midEnd = 0;
+    unsigned int originalEnd; // current ending time of the route hi
+
+    unsigned int endTime(unsigned int loRD, unsigned int loTime, unsigned int hiRD, unsigned int hiTime) const {
+        const unsigned int time = max(max(previousEnd, loRD) + loTime + midTime, midEnd);
+        return max(time, hiRD) + hiTime;
+    }
+};
 
 class NeighborSearch {
+    friend class Benchmark;
 private:
     const Instance& instance;
-    const vector<vector<unsigned int> > &W;
+    const DistanceMatrix &W;
     const vector<unsigned int> &RD;
 
     const bool applySplit;
+    const SearchOptions options;
+    bool pruneRoutes = true; // try first the pairs of routes that can change the completion time, see criticalRoute()
 
     mt19937 generator;
 
+    OperatorScheduler intraScheduler, interScheduler;
+    void nextOrder(const OperatorScheduler &scheduler, vector<unsigned int> &searchOrder);
+    void recordCall(OperatorScheduler &scheduler, unsigned int op, unsigned int gain,
+                    unsigned long long evaluationsBefore, chrono::steady_clock::time_point start);
+
+    unsigned long long evaluations = 0; // number of moves evaluated
+    unsigned long long splits = 0; // number of calls to the split algorithm
+    unsigned long long moves = 0; // number of improving moves applied
+
+    vector<unsigned int> arcsBuffer1, arcsBuffer2; // arc times of the route views, reused between the moves
+    RouteCache cache1, cache2; // prefix data of the routes in the segment operators
+
+    // scratch memory of the searches, reused between the calls so the education does not allocate
+    vector<unsigned int> intraOrder, interOrder; // current order of the operators
+    vector<pair<unsigned int, unsigned int> > routePairs; // pairs of routes of the inter route searches
+    vector<unsigned int> moveBuffer; // clients moved between two routes
+    vector<unsigned int> timeForward, timeBack, rdBack; // prefix and suffix data of insertDepotAndReorder
+    vector<unsigned int> splitEnds;
+    Sequence tour; // giant tour changed by giantTourSearch
+    SplitEngine splitEngine; // keeps the labels of the unchanged start of the giant tour between the splits
+
+    // move of a segment operator between the routes lo < hi, with the new release dates and times of both routes
+    struct InterMove {
+        unsigned int end; // ending time of the route hi after the move
+        unsigned int loRD, loTime, hiRD, hiTime;
+        bool fromLo; // orOpt: the segment leaves the route lo
+        unsigned int i, n, j, m; // positions and sizes of the segments
+    };
+
+    // operators statistics: the intra operators, the inter operators and the split, in that order
+    static const unsigned int INTRA_OPERATORS = 6, INTER_OPERATORS = 6, SPLIT_OPERATOR = 12;
+    vector<OperatorStats> operatorStats = vector<OperatorStats>(SPLIT_OPERATOR + 1);
+    OperatorStats educateStats;
+#ifdef TSPRD_PROFILE
+    void recordStats(OperatorStats &stats, chrono::steady_clock::time_point start,
+                     unsigned long long evaluationsBefore, unsigned long long movesBefore, unsigned int gain);
+#endif
+
     unsigned int callIntraSearch(vector<unsigned int> *route, unsigned int which);
+    unsigned int runIntraSearch(vector<unsigned int> *route, unsigned int which);
     unsigned int swapSearch(vector<unsigned int> *route, unsigned int n1 = 1, unsigned int n2 = 1);
     unsigned int swapSearchIt(vector<unsigned int> *route, unsigned int n1, unsigned int n2);
-    int verifySwap(vector<unsigned int> *route, unsigned int i1, unsigned int i2,
+    int verifySwap(const RouteView &route, unsigned int i1, unsigned int i2,
                             unsigned int n1, unsigned int n2);
     unsigned int reinsertionSearch(vector<unsigned int> *route, unsigned int n = 1);
     unsigned int reinsertionSearchIt(vector<unsigned int> *route, unsigned int n);
     unsigned int twoOptSearch(vector<unsigned int> *route);
     unsigned int twoOptSearchIt(vector<unsigned int> *route);
+    // the intra route moves of the coordinate mode, see granular()
+    void swapCandidates(const RouteView &view, unsigned int n1, unsigned int n2, int &bestGain, unsigned int &bestI,
+                        unsigned int &bestJ);
+    void reinsertionCandidates(const vector<unsigned int> &route, unsigned int n, int &bestGain, unsigned int &bestI,
+                               unsigned int &bestJ);
+    void twoOptCandidates(const vector<unsigned int> &route, int &bestGain, unsigned int &bestI, unsigned int &bestJ);
+
+    static unsigned int criticalRoute(const Solution *solution);
+    unsigned int firstRoute(const Solution *solution) const {
+        return pruneRoutes ? criticalRoute(solution) : 0;
+    }
 
     unsigned int callInterSearch(Solution *solution, unsigned int which);
-    static unsigned int calculateEndingTime(Solution *solution, unsigned int r1, unsigned int r2);
+    unsigned int runInterSearch(Solution *solution, unsigned int which);
     unsigned int routeReleaseDateRemoving(Solution *s, unsigned int r, unsigned int vertex);
     static unsigned int verifySolutionChangingRoutes(
             Solution *solution, unsigned int r1, unsigned int r2,
             unsigned int r1RD, unsigned int r1Time, unsigned int r2RD, unsigned int r2Time
     );
     unsigned int vertexRelocation(Solution *solution);
+    // the inter route moves are compiled for the stored matrix (DistanceMatrix::Dense) and for the coordinate mode,
+    // so that the reads of W in their loops do not test the mode; the versions without the matrix call the one of
+    // the mode
+    // in the coordinate mode the moves are granular: they only try the positions that create an arc between a client
+    // and one of its Instance::nearestClients(), since each read of W computes a distance and the pairs of routes far
+    // from each other would be compared position by position (the intra route moves too, which would be quadratic in
+    // the long routes of these instances)
+    template<class Matrix>
+    static constexpr bool granular() {
+        return !is_same<Matrix, DistanceMatrix::Dense>::value;
+    }
+    vector<unsigned int> routeMark, positionOf; // route (see markRoutes()) and position of the clients
+    unsigned int currentMark = 0;
+    vector<int> candidates; // positions of a route tried by a granular move
+    void markRoutes(const vector<unsigned int> &a, const vector<unsigned int> &b = vector<unsigned int>());
+    void addCandidates(unsigned int c, bool inB, int shift);
+    void sortCandidates(int first, int last);
     unsigned int vertexRelocationIt(Solution *solution, unsigned int r1, unsigned int r2);
+    template<class Matrix>
+    unsigned int vertexRelocationIt(Solution *solution, unsigned int r1, unsigned int r2, const Matrix &matrix);
     unsigned int interSwap(Solution *solution);
     unsigned int interSwapIt(Solution *solution, unsigned int r1, unsigned int r2);
+    template<class Matrix>
+    unsigned int interSwapIt(Solution *solution, unsigned int r1, unsigned int r2, const Matrix &matrix);
     unsigned int insertDepotAndReorder(Solution *solution);
+    static PairSchedule pairSchedule(Solution *solution, unsigned int lo, unsigned int hi);
+    unsigned int segmentRD(const vector<unsigned int> &route, unsigned int i, unsigned int n) const;
+    unsigned int interRouteSearch(Solution *solution,
+                                  unsigned int (NeighborSearch::*searchIt)(Solution *, unsigned int, unsigned int));
+    unsigned int orOptIt(Solution *solution, unsigned int r1, unsigned int r2);
+    template<class Matrix>
+    unsigned int orOptIt(Solution *solution, unsigned int r1, unsigned int r2, const Matrix &matrix);
+    unsigned int twoOptStarIt(Solution *solution, unsigned int r1, unsigned int r2);
+    template<class Matrix>
+    unsigned int twoOptStarIt(Solution *solution, unsigned int r1, unsigned int r2, const Matrix &matrix);
+    unsigned int segmentSwapIt(Solution *solution, unsigned int r1, unsigned int r2);
+    template<class Matrix>
+    unsigned int segmentSwapIt(Solution *solution, unsigned int r1, unsigned int r2, const Matrix &matrix);
+    unsigned int applyInterMove(Solution *solution, unsigned int lo, unsigned int hi, const InterMove &move,
+                                const PairSchedule &schedule);
+    void applyOrOpt(Solution *solution, unsigned int lo, unsigned int hi, const InterMove &move);
+    void applyTwoOptStar(Solution *solution, unsigned int lo, unsigned int hi, const InterMove &move);
+    void applySegmentSwap(Solution *solution, unsigned int lo, unsigned int hi, const InterMove &move);
     bool insertDepotAndReorderIt(Solution *s);
     unsigned int splitNs(Solution *solution);
+    unsigned int giantTourSearch(Solution *solution);
+    bool keepTourMove(unsigned int from, unsigned int to, unsigned int &bestTime);
 public:
-    explicit NeighborSearch(const Instance& instance, bool applySplit = true);
+    NeighborSearch(const Instance& instance, unsigned int seed, bool applySplit = true,
+                   const SearchOptions &options = SearchOptions());
     unsigned int intraSearch(Solution *solution, bool all = false);
-    unsigned int interSearch(Solution *solution);
-    unsigned int educate(Solution *solution);
+    unsigned int interSearch(Solution *solution, bool all = false);
+    unsigned int educate(Solution *solution, bool all = false);
+
+    unsigned long long getEvaluations() const {
+        return evaluations;
+    }
+
+    unsigned long long getSplits() const {
+        return splits;
+    }
+
+    const SplitEngine &getSplitEngine() const {
+        return splitEngine;
+    }
+
+    static const char *operatorName(unsigned int op);
+    const vector<OperatorStats> &getOperatorStats() const {
+        return operatorStats;
+    }
+    const OperatorStats &getEducateStats() const {
+        return educateStats;
+    }
+    void printStats(ostream &out) const;
+    vector<pair<string, double> > getOperatorWeights() const;
 };
 
 
@@ -0,0 +1,89 @@
+#ifndef TSPRD_OPERATORSCHEDULER_H
+#define TSPRD_OPERATORSCHEDULER_H
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+using namespace std;
+
+/*
+ * Adaptive order of the neighborhood operators, a roulette wheel as in the adaptive large neighborhood search
+ *
+ * all the operators are drawn without replacement, each with probability proportional to its weight, so every
+ * operator is still tried before the search stops at a local optimum, only the order changes
+ * every 'segment' recorded calls the gain per cost of each operator used in the segment is normalized by the best
+ * one and mixed in its weight with the reaction factor; the minimum weight keeps the operators that stopped improving
+ * in the roulette
+ */
+class OperatorScheduler {
+    vector<unsigned int> operators; // ids of the operators
+    vector<double> weights;
+    vector<double> gains, costs; // of the current segment
+    double reaction;
+    unsigned int segment;
+    unsigned int calls = 0;
+    mutable vector<double> drawWeights; // weights of the operators not drawn yet, reused by order()
+
+    unsigned int indexOf(unsigned int op) const {
+        return find(operators.begin(), operators.end(), op) - operators.begin();
+    }
+
+    void updateWeights() {
+        const double minWeight = 0.05;
+        double bestRate = 0;
+        for (unsigned int k = 0; k < operators.size(); k++) {
+            if (costs[k] > 0) bestRate = max(bestRate, gains[k] / costs[k]);
+        }
+        for (unsigned int k = 0; k < operators.size(); k++) {
+            if (costs[k] == 0) continue; // not used in the segment
+            const double rate = bestRate > 0 ? gains[k] / costs[k] / bestRate : 0;
+            weights[k] = max(minWeight, (1 - reaction) * weights[k] + reaction * rate);
+        }
+        fill(gains.begin(), gains.end(), 0);
+        fill(costs.begin(), costs.end(), 0);
+    }
+
+public:
+    OperatorScheduler(const vector<unsigned int> &operators, double reaction, unsigned int segment)
+            : operators(operators), weights(operators.size(), 1), gains(operators.size(), 0),
+              costs(operators.size(), 0), reaction(reaction), segment(segment) {}
+
+    // fills 'order' with all the operators, drawn by weight
+    void order(vector<unsigned int> &order, mt19937 &generator) const {
+        order = operators;
+        vector<double> &w = drawWeights;
+        w = weights;
+        for (unsigned int k = 0; k + 1 < order.size(); k++) {
+            double total = 0;
+            for (unsigned int x = k; x < w.size(); x++) total += w[x];
+
+            double draw = uniform_real_distribution<double>(0, total)(generator);
+            unsigned int chosen = k;
+            while (chosen + 1 < w.size() && draw >= w[chosen]) {
+                draw -= w[chosen];
+                chosen++;
+            }
+            swap(order[k], order[chosen]);
+            swap(w[k], w[chosen]);
+        }
+    }
+
+    // a call of the operator 'op', that improved 'gain' with the given cost (evaluations or time)
+    void record(unsigned int op, unsigned int gain, double cost) {
+        const unsigned int k = indexOf(op);
+        gains[k] += gain;
+        costs[k] += max(cost, 1.0);
+        if (++calls % segment == 0) updateWeights();
+    }
+
+    const vector<unsigned int> &getOperators() const {
+        return operators;
+    }
+
+    const vector<double> &getWeights() const {
+        return weights;
+    }
+};
+
+#endif //TSPRD_OPERATORSCHEDULER_H
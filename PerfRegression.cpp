@@ -0,0 +1,228 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "Instance.h"
+#include "GeneticAlgorithm.h"
+#include "Grasp.h"
+#include "RoutePool.h"
+
+using namespace std;
+
+/*
+ * End to end performance regression harness
+ *
+ * runs the genetic algorithm and the grasp with fixed seeds and offspring budgets over a curated subset of the
+ * instances, so each run does exactly the same work in every execution, and records wall time, offspring per
+ * second, peak memory and the final objective
+ *
+ * each case is repeated and the fastest repetition is kept, to reduce the noise of the machine; the repetitions must
+ * reach the same objective, otherwise the run is not deterministic and the case fails
+ *
+ * the results are compared with a baseline file and the program fails (exit code 1) if the throughput of any case
+ * dropped more than the threshold, if its peak memory grew more than the memory threshold, or if its objective
+ * changed: since the runs are deterministic, a different objective means that the search trajectory changed, and a
+ * change of the search that is meant to be must write the baseline again with --update
+ *
+ * the baseline perfBaseline.txt is shipped, so the check runs on any checkout; the throughput and the memory depend on
+ * the machine where it was written, so the default thresholds are generous (50%), and a smaller --threshold only makes
+ * sense against a baseline written on the same machine; a case that is not in the baseline fails too
+ *
+ * usage: ./perf [--baseline <file>] [--threshold <fraction>] [--memoryThreshold <fraction>] [--repetitions <n>]
+ *              [--update]
+ *   --update writes the current results as the new baseline
+ */
+
+static const unsigned int SEED = 1;
+
+struct PerfCase {
+    string algorithm; // "ga" or "grasp"
+    string instance;
+    unsigned long long maxOffspring;
+
+    string name() const {
+        return algorithm + "/" + instance;
+    }
+};
+
+struct PerfResult {
+    unsigned int wallTime; // ms
+    double offspringPerSec;
+    long peakRss; // kB
+    unsigned int objective;
+};
+
+// runs the case in a child process, so the peak memory is measured for this case only
+bool runCase(const PerfCase &perfCase, PerfResult &result) {
+    int fd[2];
+    if (pipe(fd) != 0) return false;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fd[0]);
+        Instance instance(perfCase.instance);
+        Budget budget;
+        budget.maxOffspring = perfCase.maxOffspring;
+
+        unsigned int objective, time;
+        unsigned long long offspring;
+        if (perfCase.algorithm == "ga") {
+            RoutePool routePool(10000, instance.nClients());
+            GeneticAlgorithm ga(instance, 20, 40, 6, 10, 10000, 4000, 60 * 60, budget, routePool, SEED);
+            objective = ga.getSolution().time;
+            time = ga.getExecutionTime();
+            offspring = ga.getOffspring();
+        } else {
+            Grasp grasp(instance, 1000, 0.2, 60 * 60, budget, SEED);
+            objective = grasp.getSolution().time;
+            time = grasp.getExecutionTime();
+            offspring = grasp.getOffspring();
+        }
+
+        char buffer[100];
+        int size = sprintf(buffer, "%u %u %llu", objective, time, offspring);
+        if (write(fd[1], buffer, size + 1) != size + 1) _exit(1);
+        close(fd[1]);
+        _exit(0);
+    }
+
+    close(fd[1]);
+    char buffer[100] = {};
+    ssize_t size = read(fd[0], buffer, sizeof(buffer) - 1);
+    close(fd[0]);
+
+    int status;
+    struct rusage usage{};
+    wait4(pid, &status, 0, &usage);
+    if (size <= 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) return false;
+
+    unsigned long long offspring;
+    stringstream in(buffer);
+    in >> result.objective >> result.wallTime >> offspring;
+    result.offspringPerSec = offspring / (max(result.wallTime, 1u) / 1000.0);
+    result.peakRss = usage.ru_maxrss;
+    return true;
+}
+
+map<string, PerfResult> readBaseline(const string &file) {
+    map<string, PerfResult> baseline;
+    ifstream fin(file, ios::in);
+    string name;
+    PerfResult result{};
+    while (fin >> name >> result.wallTime >> result.offspringPerSec >> result.peakRss >> result.objective) {
+        baseline[name] = result;
+    }
+    return baseline;
+}
+
+int main(int argc, char **argv) {
+    string baselineFile = "perfBaseline.txt";
+    double threshold = 0.5; // maximum accepted throughput drop
+    double memoryThreshold = 0.5; // maximum accepted peak memory growth
+    unsigned int repetitions = 3;
+    bool update = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--baseline" && i + 1 < argc) baselineFile = argv[++i];
+        else if (arg == "--threshold" && i + 1 < argc) threshold = stod(argv[++i]);
+        else if (arg == "--memoryThreshold" && i + 1 < argc) memoryThreshold = stod(argv[++i]);
+        else if (arg == "--repetitions" && i + 1 < argc) repetitions = stoul(argv[++i]);
+        else if (arg == "--update") update = true;
+    }
+
+    vector<PerfCase> cases({
+                                   {"ga",    "Solomon/50/C101_1",  300},
+                                   {"ga",    "Solomon/100/R101_2", 300},
+                                   {"ga",    "TSPLIB/kroA100_1",   300},
+                                   {"ga",    "TSPLIB/a280_2",      100},
+                                   {"ga",    "aTSPLIB/ftv70_1",    300},
+                                   {"ga",    "aTSPLIB/kro124p_2",  300},
+                                   {"grasp", "Solomon/50/C101_1",  50},
+                                   {"grasp", "TSPLIB/kroA100_1",   20},
+                                   {"grasp", "aTSPLIB/ftv70_1",    20},
+                           });
+
+    map<string, PerfResult> baseline = readBaseline(baselineFile);
+    if (!update && baseline.empty()) {
+        cout << "ERROR no_baseline in " << baselineFile << ", run with --update to create it" << endl;
+        return 1;
+    }
+
+    char buffer[300];
+    sprintf(buffer, "%-28s %10s %12s %10s %10s %12s %9s  %s", "case", "wall(ms)", "offspring/s", "rss(MB)", "obj",
+            "base off/s", "change", "status");
+    cout << buffer << endl;
+
+    bool failed = false;
+    map<string, PerfResult> results;
+    for (auto &perfCase: cases) {
+        PerfResult result{};
+        bool ok = true, deterministic = true;
+        for (unsigned int r = 0; r < repetitions && ok; r++) {
+            PerfResult repetition{};
+            ok = runCase(perfCase, repetition);
+            if (r > 0 && repetition.objective != result.objective) deterministic = false;
+            if (r == 0 || repetition.offspringPerSec > result.offspringPerSec) result = repetition;
+        }
+        if (!ok) {
+            cout << perfCase.name() << " ERROR run_failed" << endl;
+            failed = true;
+            continue;
+        }
+        results[perfCase.name()] = result;
+
+        string status = "-";
+        double change = 0, baseThroughput = 0;
+        if (!update && baseline.count(perfCase.name()) == 0) {
+            status = "NO_BASELINE";
+            failed = true;
+        } else if (!update) {
+            const PerfResult &base = baseline[perfCase.name()];
+            baseThroughput = base.offspringPerSec;
+            change = (result.offspringPerSec / base.offspringPerSec - 1) * 100;
+            status = "OK";
+            if (result.offspringPerSec < base.offspringPerSec * (1 - threshold)) {
+                status = "SLOWER";
+                failed = true;
+            }
+            if (result.peakRss > base.peakRss * (1 + memoryThreshold)) {
+                status += " BIGGER(" + to_string(base.peakRss / 1024) + "MB)";
+                failed = true;
+            }
+            if (result.objective != base.objective) {
+                status += " OBJ_CHANGED(" + to_string(base.objective) + ")";
+                failed = true;
+            }
+        }
+        if (!deterministic) {
+            status += " NOT_DETERMINISTIC";
+            failed = true;
+        }
+
+        sprintf(buffer, "%-28s %10u %12.1f %10.1f %10u %12.1f %8.1f%%  %s", perfCase.name().c_str(), result.wallTime,
+                result.offspringPerSec, result.peakRss / 1024.0, result.objective, baseThroughput, change,
+                status.c_str());
+        cout << buffer << endl;
+    }
+
+    if (update) {
+        ofstream fout(baselineFile, ios::out);
+        for (auto &r: results) {
+            fout << r.first << " " << r.second.wallTime << " " << r.second.offspringPerSec << " "
+                 << r.second.peakRss << " " << r.second.objective << endl;
+        }
+        fout.close();
+        cout << "baseline written to " << baselineFile << endl;
+    }
+
+    if (failed) {
+        cout << "FAILED: throughput dropped more than " << threshold * 100 << "%, peak memory grew more than "
+             << memoryThreshold * 100 << "%, an objective changed, or a run failed, was not deterministic or has "
+                "no baseline" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+#ifndef TSPRD_RANDOM_H
+#define TSPRD_RANDOM_H
+
+#include <random>
+
+using namespace std;
+
+// all the random number generators of a run are derived from a single seed
+// each component (and each thread of a component) draws from its own stream, so the trajectory of
+// one component does not change when another one consumes more or less random numbers
+class Random {
+public:
+    enum Stream {
+        GENETIC_ALGORITHM = 1,
+        NEIGHBOR_SEARCH = 2,
+        GRASP = 3
+    };
+
+    // seed of the generator of 'stream' in the thread 'thread' for a run with seed 'seed'
+    static unsigned int derive(unsigned int seed, Stream stream, unsigned int thread = 0) {
+        seed_seq sequence({seed, (unsigned int) stream, thread});
+        unsigned int derived;
+        sequence.generate(&derived, &derived + 1);
+        return derived;
+    }
+
+    // seed used when the run is not required to be reproducible
+    static unsigned int randomSeed() {
+        return (random_device())();
+    }
+};
+
+#endif //TSPRD_RANDOM_H
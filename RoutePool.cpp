@@ -13,8 +13,9 @@ void RoutePool::addRoutesFrom(const Solution &solution) {
     //cout << solution.routes.size() << endl;
 
     for(unsigned int i = 0; i < solution.routes.size(); i++) {
-        auto routeData = new RouteData();
-        routeData->route = vector<unsigned int>(*(solution.routes[i]));
+        if (!probe) probe.reset(new RouteData());
+        RouteData *routeData = probe.get();
+        routeData->route.assign(solution.routes[i]->begin(), solution.routes[i]->end());
         routeData->releaseTime = solution.routeRD[i];
         routeData->duration = solution.routeTime[i];
         routeData->solTime = solution.time;
@@ -25,10 +26,7 @@ void RoutePool::addRoutesFrom(const Solution &solution) {
         //getchar();
 
         pointer = this->routesSet.insert(routeData);
-        if (!pointer.second){
-            //cout << "entrei pq era igual" << endl;
-            delete routeData;
-        }
+        if (pointer.second) probe.release(); // owned by the set
             
     }
 }
@@ -2,6 +2,7 @@
 #define TSPRD_ROUTEPOOL_H
 
 #include <vector>
+#include <memory>
 #include "Solution.h"
 
 using namespace std;
@@ -74,6 +75,7 @@ public:
     vector<RouteData *> routes;
     set<RouteData *, RoutePtrComp> routesSet;
     int nClients;
+    unique_ptr<RouteData> probe; // route looked up in the set, kept for the next one when the set already has it
 
 
     void addRoutesFrom(const Solution &solution);
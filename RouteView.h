@@ -0,0 +1,114 @@
+#ifndef TSPRD_ROUTEVIEW_H
+#define TSPRD_ROUTEVIEW_H
+
+#include <vector>
+#include <cassert>
+#include <algorithm>
+#include "DistanceMatrix.h"
+
+using namespace std;
+
+/*
+ * Read only view of a route used by the evaluation loops of the neighbor search
+ *
+ * the accesses are checked only by assertions, so debug builds still catch index bugs while release builds
+ * (NDEBUG) run the loops without the bounds checks of vector::at()
+ * it also keeps the time of the arc leaving each position of the route, so the cost of the arcs before and after
+ * a vertex are read from a contiguous array instead of the distance matrix
+ *
+ * the view is valid while the route is not changed
+ */
+class RouteView {
+    const unsigned int *vertices;
+    const unsigned int *arcs;
+    unsigned int n;
+
+public:
+    // 'arcsBuffer' holds the arc times, and must not be shared by two views in use at the same time
+    RouteView(const vector<unsigned int> &route, const DistanceMatrix &W, vector<unsigned int> &arcsBuffer)
+            : vertices(route.data()), n(route.size()) {
+        if (arcsBuffer.size() < n) arcsBuffer.resize(n);
+        for (unsigned int i = 0; i + 1 < n; i++) {
+            arcsBuffer[i] = W[vertices[i]][vertices[i + 1]];
+        }
+        arcs = arcsBuffer.data();
+    }
+
+    unsigned int operator[](unsigned int i) const {
+        assert(i < n);
+        return vertices[i];
+    }
+
+    // time of the arc (i, i + 1)
+    unsigned int arc(unsigned int i) const {
+        assert(i + 1 < n);
+        return arcs[i];
+    }
+
+    unsigned int size() const {
+        return n;
+    }
+
+    // index of the first and of the last client
+    unsigned int first() const {
+        return 1;
+    }
+
+    unsigned int last() const {
+        return n - 2;
+    }
+};
+
+/*
+ * Prefix and suffix data of a route, so the time and release date of the parts of the route that an inter route
+ * move keeps are computed in O(1)
+ *
+ * the buffers are reused, build() must be called again after the route changes
+ */
+class RouteCache {
+    vector<unsigned int> forward; // forward[i]: time from the start depot to the i-th vertex
+    vector<unsigned int> prefixRD; // prefixRD[i]: max release date of the vertices [0, i]
+    vector<unsigned int> suffixRD; // suffixRD[i]: max release date of the vertices [i, end]
+    unsigned int n = 0;
+
+public:
+    void build(const vector<unsigned int> &route, const DistanceMatrix &W, const vector<unsigned int> &RD) {
+        n = route.size();
+        forward.resize(n);
+        prefixRD.resize(n);
+        suffixRD.resize(n);
+        forward[0] = 0;
+        prefixRD[0] = RD[route[0]];
+        for (unsigned int i = 1; i < n; i++) {
+            forward[i] = forward[i - 1] + W[route[i - 1]][route[i]];
+            prefixRD[i] = max(prefixRD[i - 1], RD[route[i]]);
+        }
+        suffixRD[n - 1] = RD[route[n - 1]];
+        for (int i = (int) n - 2; i >= 0; i--) {
+            suffixRD[i] = max(suffixRD[i + 1], RD[route[i]]);
+        }
+    }
+
+    // time of the path from the i-th to the j-th vertex
+    unsigned int path(unsigned int i, unsigned int j) const {
+        assert(i <= j && j < n);
+        return forward[j] - forward[i];
+    }
+
+    // time of the path from the i-th vertex to the end depot
+    unsigned int pathToEnd(unsigned int i) const {
+        return path(i, n - 1);
+    }
+
+    unsigned int rdUntil(unsigned int i) const {
+        assert(i < n);
+        return prefixRD[i];
+    }
+
+    unsigned int rdFrom(unsigned int i) const {
+        assert(i < n);
+        return suffixRD[i];
+    }
+};
+
+#endif //TSPRD_ROUTEVIEW_H
@@ -0,0 +1,104 @@
+#ifndef TSPRD_SCHEDULE_H
+#define TSPRD_SCHEDULE_H
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+/*
+ * Ending time of a sequence of routes as a function of the time they can start: f(t) = max(t + A, B)
+ *
+ * a route with release date rd and time T is f(t) = max(t, rd) + T = max(t + T, rd + T), and the composition of
+ * two such functions is again one of them, so the routes of any interval are summarized by the pair (A, B)
+ * (A: sum of the times of the routes, B: ending time of the routes when they start as soon as possible)
+ */
+struct MaxPlus {
+    unsigned int A = 0, B = 0; // the identity: f(t) = t
+
+    MaxPlus() = default;
+
+    MaxPlus(unsigned int A, unsigned int B) : A(A), B(B) {}
+
+    static MaxPlus route(unsigned int rd, unsigned int time) {
+        return {time, rd + time};
+    }
+
+    unsigned int apply(unsigned int t) const {
+        return max(t + A, B);
+    }
+
+    // the routes of this function followed by the routes of 'next'
+    MaxPlus then(const MaxPlus &next) const {
+        return {A + next.A, max(B + next.A, next.B)};
+    }
+};
+
+/*
+ * Segment tree of the routes of a solution in the max-plus form above
+ *
+ * the ending time of any interval of routes, and so the completion time of the solution after changing one or two
+ * routes, is computed in O(log R) without changing the solution
+ */
+class Schedule {
+    vector<MaxPlus> tree; // tree[1] is the root, the leaves start at 'leaves'
+    unsigned int leaves = 1;
+    unsigned int n = 0;
+
+public:
+    void build(const vector<unsigned int> &routeRD, const vector<unsigned int> &routeTime) {
+        n = routeRD.size();
+        leaves = 1;
+        while (leaves < n) leaves *= 2;
+        tree.assign(2 * leaves, MaxPlus());
+        for (unsigned int r = 0; r < n; r++) {
+            tree[leaves + r] = MaxPlus::route(routeRD[r], routeTime[r]);
+        }
+        for (unsigned int i = leaves - 1; i > 0; i--) {
+            tree[i] = tree[2 * i].then(tree[2 * i + 1]);
+        }
+    }
+
+    // changes the release date and time of the route r
+    void set(unsigned int r, unsigned int rd, unsigned int time) {
+        unsigned int i = leaves + r;
+        tree[i] = MaxPlus::route(rd, time);
+        for (i /= 2; i > 0; i /= 2) {
+            tree[i] = tree[2 * i].then(tree[2 * i + 1]);
+        }
+    }
+
+    unsigned int size() const {
+        return n;
+    }
+
+    // the routes first..last (the identity if the interval is empty)
+    MaxPlus range(int first, int last) const {
+        MaxPlus left, right;
+        if (first > last) return left;
+        for (unsigned int lo = leaves + first, hi = leaves + last + 1; lo < hi; lo /= 2, hi /= 2) {
+            if (lo & 1u) left = left.then(tree[lo++]);
+            if (hi & 1u) right = tree[--hi].then(right);
+        }
+        return left.then(right);
+    }
+
+    // ending time of the route r
+    unsigned int endOf(unsigned int r) const {
+        return range(0, r).apply(0);
+    }
+
+    // completion time of the solution
+    unsigned int endTime() const {
+        return n == 0 ? 0 : tree[1].apply(0);
+    }
+
+    // ending time of the route r2 > r1 if the routes r1 and r2 were (rd1, time1) and (rd2, time2)
+    unsigned int endChanging(unsigned int r1, unsigned int rd1, unsigned int time1,
+                             unsigned int r2, unsigned int rd2, unsigned int time2) const {
+        return range(0, (int) r1 - 1).then(MaxPlus::route(rd1, time1)).then(range(r1 + 1, (int) r2 - 1))
+                .then(MaxPlus::route(rd2, time2)).apply(0);
+    }
+};
+
+#endif //TSPRD_SCHEDULE_H
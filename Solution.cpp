@@ -20,12 +20,10 @@ Solution::Solution(
 Solution::Solution(
         const Instance &instance, Sequence &sequence, set<unsigned int> *depotVisits
 ) : instance(&instance), N(sequence.size()) {
-    set<unsigned int> depotVisitsTmp; // clients at the end of each route
     if (depotVisits == nullptr) {
-        depotVisits = &depotVisitsTmp;
-        Split::split(depotVisitsTmp, instance.getW(), instance.getRD(), sequence);
-        // the split function return the time of the best routes and insert the last element of each route
-        // in the depotVisits set
+        // the split function gives the position of the last client of each route
+        assign(sequence);
+        return;
     }
 
     // create the routes given the depotVisits set
@@ -44,33 +42,129 @@ Solution::Solution(
     time = update(); // calculate the times
 }
 
+Solution::Solution(const Instance &instance, const Sequence &sequence, const vector<unsigned int> &ends)
+        : instance(&instance), N(sequence.size()) {
+    assign(sequence, ends);
+}
+
+vector<unsigned int> *Solution::newRoute() {
+    if (spareRoutes.empty()) return new vector<unsigned int>();
+    vector<unsigned int> *route = spareRoutes.back();
+    spareRoutes.pop_back();
+    route->clear();
+    return route;
+}
+
+void Solution::releaseRoute(vector<unsigned int> *route) {
+    spareRoutes.push_back(route);
+}
+
+void Solution::resizeRoutes(unsigned int nRoutes) {
+    while (routes.size() > nRoutes) {
+        releaseRoute(routes.back());
+        routes.pop_back();
+    }
+    while (routes.size() < nRoutes) {
+        routes.push_back(newRoute());
+    }
+}
+
+void Solution::assign(const Sequence &sequence, const vector<unsigned int> &ends) {
+    N = sequence.size();
+    resizeRoutes(ends.size());
+    unsigned int i = 0;
+    for (unsigned int r = 0; r < ends.size(); r++) {
+        vector<unsigned int> &route = *routes[r];
+        route.clear();
+        route.push_back(0);
+        for (; i <= ends[r]; i++) {
+            route.push_back(sequence[i]);
+        }
+        route.push_back(0);
+    }
+    time = update();
+    this->sequence = sequence;
+    sequenceValid = true;
+}
+
+void Solution::assign(const Sequence &sequence) {
+    static thread_local vector<unsigned int> ends;
+    Split::split(ends, instance->getW(), instance->getRD(), sequence);
+    assign(sequence, ends);
+}
+
+void Solution::updateRoute(unsigned int r) {
+    auto &route = routes[r];
+    routeRD[r] = 0;
+    routeTime[r] = 0;
+
+    for (unsigned int i = 1; i < route->size(); i++) {
+        // calculate time to perform route
+        routeTime[r] += instance->time(route->at(i - 1), route->at(i));
+
+        // and verify the maximum release date of the route
+        unsigned int rdi = instance->releaseDateOf(route->at(i));
+        if (rdi > routeRD[r]) {
+            routeRD[r] = rdi;
+        }
+    }
+}
+
 unsigned int Solution::update() {
     routeRD.resize(routes.size());
     routeTime.resize(routes.size());
+    changedRoutes.clear();
 
     for (unsigned int r = 0; r < routes.size(); r++) {
-        auto &route = routes[r];
-        routeRD[r] = 0;
-        routeTime[r] = 0;
-
-        for (unsigned int i = 1; i < route->size(); i++) {
-            // calculate time to perform route
-            routeTime[r] += instance->time(route->at(i - 1), route->at(i));
-
-            // and verify the maximum release date of the route
-            unsigned int rdi = instance->releaseDateOf(route->at(i));
-            if (rdi > routeRD[r]) {
-                routeRD[r] = rdi;
-            }
-        }
+        updateRoute(r);
     }
 
     return updateStartingTimes();
 }
 
+void Solution::markChanged(unsigned int r) {
+    changedRoutes.push_back(r);
+}
+
+unsigned int Solution::updateChanged() {
+    if (!changedRoutes.empty()) {
+        unsigned int from = routes.size();
+        for (unsigned int r: changedRoutes) {
+            updateRoute(r);
+            from = min(from, r);
+        }
+        changedRoutes.clear();
+        updateStartingTimes(from);
+    }
+
+#ifdef TSPRD_CHECK
+    // the routes not marked must be up to date, checked without changing the solution
+    unsigned int end = 0;
+    for (unsigned int r = 0; r < routes.size(); r++) {
+        unsigned int rd = 0, duration = 0;
+        for (unsigned int i = 1; i < routes[r]->size(); i++) {
+            duration += instance->time(routes[r]->at(i - 1), routes[r]->at(i));
+            rd = max(rd, instance->releaseDateOf(routes[r]->at(i)));
+        }
+        if (rd != routeRD[r] || duration != routeTime[r]) {
+            cout << "ERROR stale_route " << r << endl;
+            exit(1);
+        }
+        end = max(end, rd) + duration;
+    }
+    if (end != time) {
+        cout << "ERROR stale_time " << time << " " << end << endl;
+        exit(1);
+    }
+#endif
+    return time;
+}
+
 // must be called when changes are made to the release date and times of the routes
 unsigned int Solution::updateStartingTimes(unsigned int from) {
     routeStart.resize(routes.size());
+    sequenceValid = false;
+    hashValid = false;
 
     for (unsigned int r = from; r < routes.size(); r++) {
         // calculate the starting time of route = max between release time and finishing time of the previous route
@@ -78,6 +172,7 @@ unsigned int Solution::updateStartingTimes(unsigned int from) {
         routeStart[r] = r == 0 ? routeRD[r] : max(routeRD[r], routeStart[r - 1] + routeTime[r - 1]); //
     }
     this->time = routeStart.back() + routeTime.back();
+    schedule.build(routeRD, routeTime);
     return time;
 }
 
@@ -87,14 +182,16 @@ bool Solution::removeEmptyRoutes() {
     bool hasEmpty = false;
     for (int r = (int) routes.size() - 1; r >= 0; r--) {
         if (routes[r]->size() == 2) { // just the depot at start and end
-            delete routes[r];
+            releaseRoute(routes[r]);
             routes.erase(routes.begin() + r);
             routeRD.erase(routeRD.begin() + r);
             routeTime.erase(routeTime.begin() + r);
             routeStart.erase(routeStart.begin() + r);
             hasEmpty = true;
+            hashValid = false;
         }
     }
+    if (hasEmpty) schedule.build(routeRD, routeTime);
     return hasEmpty;
 }
 
@@ -108,15 +205,20 @@ Solution *Solution::copy() const {
     sol->routeTime = this->routeTime;
     sol->routeStart = this->routeStart;
     sol->time = this->time;
+    if (sequenceValid) {
+        sol->sequence = this->sequence;
+        sol->sequenceValid = true;
+    }
+    sol->hash = this->hash;
+    sol->hashValid = this->hashValid;
+    sol->schedule = this->schedule;
     return sol;
 }
 
 void Solution::mirror(Solution *s) {
-    for (auto *r: this->routes) delete r;
-    this->routes.clear();
-    this->routes.reserve(s->routes.size());
-    for(auto *r: s->routes) {
-        this->routes.push_back(new vector<unsigned int>(*r));
+    resizeRoutes(s->routes.size());
+    for (unsigned int r = 0; r < routes.size(); r++) {
+        *routes[r] = *s->routes[r]; // reuses the capacity of the route
     }
     this->routeRD = s->routeRD;
     this->routeTime = s->routeTime;
@@ -124,18 +226,53 @@ void Solution::mirror(Solution *s) {
     this->time = s->time;
     this->id = s->id;
     this->N = s->N;
+    this->sequenceValid = s->sequenceValid;
+    if (s->sequenceValid) this->sequence = s->sequence;
+    this->hash = s->hash;
+    this->hashValid = s->hashValid;
+    this->schedule = s->schedule;
+}
+
+const Sequence &Solution::getSequence() const {
+    if (!sequenceValid) {
+        toSequence(sequence);
+        sequenceValid = true;
+    }
+    return sequence;
+}
+
+// FNV-1a of the clients with the depot between the routes, followed by the finalizer of splitmix64
+unsigned long long Solution::getHash() const {
+    if (!hashValid) {
+        unsigned long long h = 14695981039346656037ull;
+        for (const vector<unsigned int> *route: routes) {
+            for (unsigned int i = 0; i + 1 < route->size(); i++) { // the start depot and the clients
+                h = (h ^ route->at(i)) * 1099511628211ull;
+            }
+        }
+        h = (h ^ (h >> 30u)) * 0xbf58476d1ce4e5b9ull;
+        h = (h ^ (h >> 27u)) * 0x94d049bb133111ebull;
+        hash = h ^ (h >> 31u);
+        hashValid = true;
+    }
+    return hash;
 }
 
 Sequence *Solution::toSequence() const {
     auto *s = new Sequence(this->N);
+    toSequence(*s);
+    return s;
+}
+
+void Solution::toSequence(Sequence &sequence) const {
+    sequence.resize(this->N);
     int i = 0;
     for (const vector<unsigned int> *route: routes) {
         for (unsigned int j = 1; j < route->size() - 1; j++) {
-            s->at(i) = route->at(j);
+            sequence[i] = route->at(j);
             i++;
         }
     }
-    return s;
 }
 
 void Solution::printRoutes() {
@@ -145,9 +282,9 @@ void Solution::printRoutes() {
         cout << "   starts at " << routeStart[i];
         cout << "   ends at " << routeStart[i] + routeTime[i] << endl;
 
-        cout << routes[i]->at(0);
+        cout << instance->originalId(routes[i]->at(0));
         for (unsigned int j = 1; j < routes[i]->size(); j++) {
-            cout << " -> " << routes[i]->at(j);
+            cout << " -> " << instance->originalId(routes[i]->at(j));
         }
         cout << endl;
     }
@@ -174,22 +311,35 @@ void Solution::validate() {
         }
     }
 
+    // the routes are checked with the ids and the data of the instance file: with the clients renumbered, a wrong
+    // permutation of W or RD gives other release dates and times than the ones of the solution
+    const Instance *file = instance->isRelabeled() ? new Instance(instance->getName()) : instance;
+    vector<vector<unsigned int> > fileRoutes(routes.size());
+    for (unsigned int r = 0; r < routes.size(); r++) {
+        for (unsigned int v: *routes[r]) {
+            fileRoutes[r].push_back(instance->originalId(v));
+        }
+        if (fileRoutes[r].front() != 0 || fileRoutes[r].back() != 0) {
+            printError("depot_relabeled");
+        }
+    }
+
     // check if all clients are visited once
     vector<bool> visited(instance->nVertex(), false);
     visited[0] = true;
-    for (auto &route: routes) {
-        for (unsigned int i = 1; i < route->size() - 1; i++) {
-            if (visited[route->at(i)])
+    for (auto &route: fileRoutes) {
+        for (unsigned int i = 1; i < route.size() - 1; i++) {
+            if (visited[route[i]])
                 printError("client_visited_more_than_once");
-            visited[route->at(i)] = true;
+            visited[route[i]] = true;
         }
     }
 
     // check all routes release date
     for (unsigned int r = 0; r < routes.size(); r++) {
         unsigned int rd = 0;
-        for (unsigned int i = 1; i < routes[r]->size(); i++) {
-            rd = max(rd, instance->releaseDateOf(routes[r]->at(i)));
+        for (unsigned int i = 1; i < fileRoutes[r].size(); i++) {
+            rd = max(rd, file->releaseDateOf(fileRoutes[r][i]));
         }
         if (routeRD[r] != rd) {
             printError("route_with_incorrect_release_date");
@@ -199,13 +349,14 @@ void Solution::validate() {
     // check all routes times
     for (unsigned int r = 0; r < routes.size(); r++) {
         unsigned int rtime = 0;
-        for (unsigned int i = 1; i < routes[r]->size(); i++) {
-            rtime += instance->time(routes[r]->at(i - 1), routes[r]->at(i));
+        for (unsigned int i = 1; i < fileRoutes[r].size(); i++) {
+            rtime += file->time(fileRoutes[r][i - 1], fileRoutes[r][i]);
         }
         if (routeTime[r] != rtime) {
             printError("route_with_incorrect_time");
         }
     }
+    if (file != instance) delete file;
 
     // check all routes starting times
     for (unsigned int r = 0; r < routes.size(); r++) {
@@ -222,7 +373,7 @@ void Solution::validate() {
 }
 
 bool Solution::equals(Solution *other) const {
-    if (this->time != other->time || this->routes.size() != other->routes.size())
+    if (this->time != other->time || this->routes.size() != other->routes.size() || getHash() != other->getHash())
         return false;
 
     for (unsigned int r = 0; r < this->routes.size(); r++) {
@@ -255,4 +406,7 @@ Solution::~Solution() {
         delete r;
     }
     routes.clear();
+    for (auto r : spareRoutes) {
+        delete r;
+    }
 }
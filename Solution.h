@@ -4,6 +4,7 @@
 #include <vector>
 #include <set>
 #include "Instance.h"
+#include "Schedule.h"
 #include <memory>
 #include <limits>
 
@@ -14,9 +15,28 @@ class Solution {
 private:
     const Instance *instance;
     explicit Solution(const Instance *instance);
+
+    // emptied routes kept with their capacity, reused when the solution needs more routes
+    vector<vector<unsigned int> *> spareRoutes;
+    void releaseRoute(vector<unsigned int> *route);
+    void resizeRoutes(unsigned int nRoutes);
+
+    // giant tour of the routes, rebuilt by getSequence() only after the routes changed
+    mutable Sequence sequence;
+    mutable bool sequenceValid = false;
+
+    // structural hash of the routes, recomputed by getHash() only after the routes changed
+    mutable unsigned long long hash = 0;
+    mutable bool hashValid = false;
+
+    Schedule schedule; // the routes in max-plus form, rebuilt with the starting times
+
+    vector<unsigned int> changedRoutes; // routes marked by markChanged(), not updated yet
+    void updateRoute(unsigned int r);
 public:
     Solution(const Instance &instance, Sequence &sequence, set<unsigned int> *depotVisits = nullptr); // create a solution given the sequence, by applying the split algorithm
     Solution(const Instance &instance, vector<vector<unsigned int> *> routes); // create a solution given the routes
+    Solution(const Instance &instance, const Sequence &sequence, const vector<unsigned int> &ends); // see assign()
     vector<vector<unsigned int>* > routes;
 
     vector<unsigned int> routeRD; // release date of each route
@@ -29,14 +49,43 @@ public:
 
     // should be called if the routes change to update values of RD, Time and Start
     // returns the new completion time
+    // (update and updateStartingTimes also mark the giant tour and the hash as outdated)
     unsigned int update();
+
+    // the route r changed, but the routes were not inserted or removed: only the marked routes are recalculated by
+    // updateChanged(), and the starting times from the first of them on
+    void markChanged(unsigned int r);
+    unsigned int updateChanged();
+
+    // empty route (without the depots) taken from the spare routes of the solution, for a route being inserted
+    vector<unsigned int> *newRoute();
+
+    // rebuild the solution in place with the given sequence, reusing the memory of the routes
+    // 'ends' are the positions of the last client of each route, as given by the split algorithm
+    void assign(const Sequence &sequence, const vector<unsigned int> &ends);
+    void assign(const Sequence &sequence); // applies the split algorithm
     unsigned int updateStartingTimes(unsigned int from = 0);
+
+    // ending times of the routes, valid after update() or updateStartingTimes()
+    const Schedule &getSchedule() const {
+        return schedule;
+    }
+
     bool removeEmptyRoutes();
 
+    // checks the solution against the instance file, with its ids and its data
     void validate();
+
+    // the routes with the ids of the instance file
     void printRoutes();
 
+    // the clients in the order they are visited, without the depot visits (the giant tour)
+    const Sequence &getSequence() const;
+
+    // 64 bits hash of the routes: equal solutions have equal hashes
+    unsigned long long getHash() const;
     Sequence *toSequence() const;
+    void toSequence(Sequence &sequence) const;
 
     Solution *copy() const;
 
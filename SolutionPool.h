@@ -0,0 +1,79 @@
+#ifndef TSPRD_SOLUTIONPOOL_H
+#define TSPRD_SOLUTIONPOOL_H
+
+#include <vector>
+#include "Solution.h"
+
+using namespace std;
+
+/*
+ * Free list of solutions and sequences of the genetic algorithm
+ *
+ * the individuals removed by the survival selection are released here and their memory (routes, times, sequence)
+ * is reused by the next offspring, so after the first generations the main loop does not allocate new solutions
+ * the pool owns the released objects and deletes them when it is destroyed
+ */
+class SolutionPool {
+    const Instance &instance;
+    vector<Solution *> solutions;
+    vector<Sequence *> sequences;
+
+public:
+    explicit SolutionPool(const Instance &instance) : instance(instance) {}
+
+    SolutionPool(const SolutionPool &) = delete;
+    SolutionPool &operator=(const SolutionPool &) = delete;
+
+    SolutionPool(SolutionPool &&other) noexcept
+            : instance(other.instance), solutions(move(other.solutions)), sequences(move(other.sequences)) {}
+
+    // solution with the routes given by the split of 'sequence'
+    Solution *acquire(Sequence &sequence) {
+        if (solutions.empty()) return new Solution(instance, sequence);
+        Solution *s = solutions.back();
+        solutions.pop_back();
+        s->assign(sequence);
+        return s;
+    }
+
+    // solution with the given routes of 'sequence', see Solution::assign
+    Solution *acquire(const Sequence &sequence, const vector<unsigned int> &ends) {
+        if (solutions.empty()) return new Solution(instance, sequence, ends);
+        Solution *s = solutions.back();
+        solutions.pop_back();
+        s->assign(sequence, ends);
+        return s;
+    }
+
+    // copy of the solution 's'
+    Solution *acquire(Solution *s) {
+        if (solutions.empty()) return s->copy();
+        Solution *copy = solutions.back();
+        solutions.pop_back();
+        copy->mirror(s);
+        return copy;
+    }
+
+    void release(Solution *s) {
+        solutions.push_back(s);
+    }
+
+    // sequence with undefined content
+    Sequence *acquireSequence() {
+        if (sequences.empty()) return new Sequence();
+        Sequence *s = sequences.back();
+        sequences.pop_back();
+        return s;
+    }
+
+    void release(Sequence *s) {
+        sequences.push_back(s);
+    }
+
+    ~SolutionPool() {
+        for (auto *s: solutions) delete s;
+        for (auto *s: sequences) delete s;
+    }
+};
+
+#endif //TSPRD_SOLUTIONPOOL_H
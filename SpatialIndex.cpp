@@ -0,0 +1,99 @@
+#include "SpatialIndex.h"
+#include <algorithm>
+
+SpatialIndex::SpatialIndex(const vector<double> &X, const vector<double> &Y, const vector<unsigned int> &ids) {
+    points.reserve(ids.size());
+    for (unsigned int id: ids) {
+        points.push_back({X[id], Y[id], id});
+    }
+    splitY.assign(points.size(), 0);
+    build(0, points.size());
+}
+
+void SpatialIndex::build(unsigned int lo, unsigned int hi) {
+    if (hi - lo <= LEAF) return;
+
+    double minX = points[lo].x, maxX = minX, minY = points[lo].y, maxY = minY;
+    for (unsigned int i = lo + 1; i < hi; i++) {
+        minX = min(minX, points[i].x);
+        maxX = max(maxX, points[i].x);
+        minY = min(minY, points[i].y);
+        maxY = max(maxY, points[i].y);
+    }
+
+    const unsigned int mid = (lo + hi) / 2;
+    const bool byY = maxY - minY > maxX - minX;
+    splitY[mid] = byY;
+    nth_element(points.begin() + lo, points.begin() + mid, points.begin() + hi, [byY](const Point &a, const Point &b) {
+        return byY ? a.y < b.y : a.x < b.x;
+    });
+    build(lo, mid);
+    build(mid + 1, hi);
+}
+
+void SpatialIndex::visit(const Point &p, double x, double y, unsigned int k) const {
+    const pair<double, unsigned int> candidate((p.x - x) * (p.x - x) + (p.y - y) * (p.y - y), p.id);
+    if (heap.size() < k) {
+        heap.push_back(candidate);
+        push_heap(heap.begin(), heap.end());
+    } else if (candidate < heap.front()) {
+        pop_heap(heap.begin(), heap.end());
+        heap.back() = candidate;
+        push_heap(heap.begin(), heap.end());
+    }
+}
+
+void SpatialIndex::nearest(unsigned int lo, unsigned int hi, double x, double y, unsigned int k) const {
+    if (hi - lo <= LEAF) {
+        for (unsigned int i = lo; i < hi; i++) {
+            visit(points[i], x, y, k);
+        }
+        return;
+    }
+
+    const unsigned int mid = (lo + hi) / 2;
+    const double d = splitY[mid] ? y - points[mid].y : x - points[mid].x;
+    visit(points[mid], x, y, k);
+    // the side of the query first, the other one only if it can have a closer point (or a tie with a smaller id)
+    if (d < 0) nearest(lo, mid, x, y, k);
+    else nearest(mid + 1, hi, x, y, k);
+    if (heap.size() < k || d * d <= heap.front().first) {
+        if (d < 0) nearest(mid + 1, hi, x, y, k);
+        else nearest(lo, mid, x, y, k);
+    }
+}
+
+void SpatialIndex::nearest(double x, double y, unsigned int k, vector<unsigned int> &result) const {
+    heap.clear();
+    result.clear();
+    if (k == 0) return;
+    nearest(0, points.size(), x, y, k);
+    sort_heap(heap.begin(), heap.end());
+    for (auto &p: heap) {
+        result.push_back(p.second);
+    }
+}
+
+void SpatialIndex::withinRadius(unsigned int lo, unsigned int hi, double x, double y, double radius2,
+                                vector<unsigned int> &result) const {
+    if (hi - lo <= LEAF) {
+        for (unsigned int i = lo; i < hi; i++) {
+            const Point &p = points[i];
+            if ((p.x - x) * (p.x - x) + (p.y - y) * (p.y - y) <= radius2) result.push_back(p.id);
+        }
+        return;
+    }
+
+    const unsigned int mid = (lo + hi) / 2;
+    const Point &p = points[mid];
+    const double d = splitY[mid] ? y - p.y : x - p.x;
+    if ((p.x - x) * (p.x - x) + (p.y - y) * (p.y - y) <= radius2) result.push_back(p.id);
+    if (d <= 0 || d * d <= radius2) withinRadius(lo, mid, x, y, radius2, result);
+    if (d >= 0 || d * d <= radius2) withinRadius(mid + 1, hi, x, y, radius2, result);
+}
+
+void SpatialIndex::withinRadius(double x, double y, double radius, vector<unsigned int> &result) const {
+    result.clear();
+    withinRadius(0, points.size(), x, y, radius * radius, result);
+    sort(result.begin(), result.end());
+}
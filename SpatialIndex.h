@@ -0,0 +1,56 @@
+#ifndef TSPRD_SPATIALINDEX_H
+#define TSPRD_SPATIALINDEX_H
+
+#include <vector>
+#include <utility>
+
+using namespace std;
+
+/*
+ * k-d tree over points of the plane, for the k nearest points and the points within a radius of a position
+ *
+ * the tree is implicit in the array of the points: the node of the range [lo, hi) is the median 'mid' on the axis of
+ * the bigger spread of the range, with the points before it on one side and the points after it on the other
+ * building takes O(n log n), and the queries visit only the ranges that can be closer than the points found so far
+ */
+class SpatialIndex {
+    struct Point {
+        double x, y;
+        unsigned int id;
+    };
+
+    static const unsigned int LEAF = 8; // ranges scanned without splitting them
+
+    vector<Point> points;
+    vector<unsigned char> splitY; // splitY[mid]: the node of the median 'mid' splits on y
+
+    // heap of the k nearest points found by the query, the farthest on top
+    mutable vector<pair<double, unsigned int> > heap;
+
+    void build(unsigned int lo, unsigned int hi);
+
+    void nearest(unsigned int lo, unsigned int hi, double x, double y, unsigned int k) const;
+
+    void withinRadius(unsigned int lo, unsigned int hi, double x, double y, double radius2,
+                      vector<unsigned int> &result) const;
+
+    void visit(const Point &p, double x, double y, unsigned int k) const;
+
+public:
+    SpatialIndex() = default;
+
+    // indexes the points ids[i], at (X[ids[i]], Y[ids[i]])
+    SpatialIndex(const vector<double> &X, const vector<double> &Y, const vector<unsigned int> &ids);
+
+    unsigned int size() const {
+        return points.size();
+    }
+
+    // the ids of the k points closest to (x, y), closest first (the ties by id)
+    void nearest(double x, double y, unsigned int k, vector<unsigned int> &result) const;
+
+    // the ids of the points at distance <= radius of (x, y), in increasing order
+    void withinRadius(double x, double y, double radius, vector<unsigned int> &result) const;
+};
+
+#endif //TSPRD_SPATIALINDEX_H
@@ -3,67 +3,357 @@
 
 #include <set>
 #include <vector>
+#include <limits>
+#include <algorithm>
+#include "DistanceMatrix.h"
 
 using namespace std;
 
 class Split {
 public:
+    /*
+     * Finds the best routes that visit the clients in the order of S, returns their completion time and fills 'ends'
+     * with the position in S of the last client of each route, in order (the last one is always S.size() - 1)
+     *
+     * the release date and the time of the route with the clients i..j are accumulated while j advances, so no table
+     * of all the routes is stored; the scratch arrays are reused between the calls of the thread
+     */
     static unsigned int split(
-            set<unsigned int> &visits, const vector<vector<unsigned int> > &W, const vector<unsigned int> &RD,
+            vector<unsigned int> &ends, const DistanceMatrix &W, const vector<unsigned int> &RD,
             const vector<unsigned int> &S
     ) {
-        const unsigned int V = RD.size(), // total number of vertex, including the depot
-        N = V - 1; // total number of clients (excluding the depot)
-
-        /*
-         * Calculate the bigger release dates between the i-th and j-th clients
-         * This value is the release date of the route that visits those clients
-         *
-         * Also calculate the time to perform a route that visits those clients in that order
-         * including the times from the depot to the i-th client, and from the j-th client to the depot
-         */
-        vector<vector<unsigned int> > routesRD(N, vector<unsigned int>(N));
-        vector<vector<unsigned int> > routesTime(N, vector<unsigned int>(N));
+        static thread_local vector<unsigned int> bestIn, delta;
+        const unsigned int N = S.size(); // total number of clients
+
+        bestIn.resize(N + 1); // store the origin of the best arc arriving at i
+        delta.assign(N + 1, numeric_limits<unsigned int>::max()); // value of the best arc arriving at i
+        delta[0] = 0;
+
         for (unsigned int i = 0; i < N; i++) {
+            // release date and time of the route that visits the clients i..j-1 in that order
+            // including the times from the depot to the i-th client, and from the (j-1)-th client to the depot
             unsigned int bigger = RD[S[i]];
             unsigned int sumTimes = W[0][S[i]];
+            for (unsigned int j = i + 1; j <= N; j++) {
+                if (j - 1 > i) {
+                    bigger = max(bigger, RD[S[j - 1]]);
+                    sumTimes += W[S[j - 2]][S[j - 1]];
+                }
+                unsigned int deltaJ = max(bigger, delta[i]) + sumTimes + W[S[j - 1]][0];
+                if (deltaJ < delta[j]) {
+                    delta[j] = deltaJ;
+                    bestIn[j] = i;
+                }
+            }
+        }
 
-            routesRD[i][i] = bigger;
-            routesTime[i][i] = sumTimes + W[S[i]][0];
+        ends.clear();
+        for (unsigned int x = N; x > 0; x = bestIn[x]) {
+            ends.push_back(x - 1);
+        }
+        reverse(ends.begin(), ends.end());
 
-            for (unsigned int j = i + 1; j < S.size(); j++) {
-                unsigned int rdj = RD[S[j]];
-                if (rdj > bigger) {
-                    bigger = rdj;
+        return delta.back();
+    }
+
+    // same as above, inserting in 'visits' the last client of each route but the last one
+    static unsigned int split(
+            set<unsigned int> &visits, const DistanceMatrix &W, const vector<unsigned int> &RD,
+            const vector<unsigned int> &S
+    ) {
+        static thread_local vector<unsigned int> ends;
+        const unsigned int time = split(ends, W, RD, S);
+        for (unsigned int r = 0; r + 1 < ends.size(); r++) {
+            visits.insert(S[ends[r]]);
+        }
+        return time;
+    }
+};
+
+/*
+ * Split that keeps the labels of its last sequence: the label of the position j (best completion time of the clients
+ * before j) depends only on the clients before j, so when the next sequence starts with the same clients up to the
+ * position p, only the labels after p are recomputed
+ *
+ * each label is computed from the routes that end at its position, the ties are broken as in Split::split, so both
+ * give the same routes
+ * the routes are extended backwards, and when W satisfies the triangle inequality from the depot (see
+ * Instance::isDepotTriangular) their release date and time never decrease: once the route alone ends after the best
+ * label found, no longer route can improve it, so a label costs about the length of the routes instead of its position
+ *
+ * evaluate gives the exact best split of a sequence changed in a few positions, from the labels before the change and
+ * two tables of the last sequence, both built lazily and kept while their clients do not change:
+ * - the heads of a position p, the routes started before p that are still open at p, as (release date, time) pairs
+ * - the tails of a position p, the best completions of the clients p.. after an open route that arrives at p, as
+ *   max-plus functions of the release date and the time of that route
+ * the labels of the changed positions are computed with the heads, and the routes open over the end of the change are
+ * composed with its tails; both keep only their pareto optimal entries that can end before the last split
+ */
+class SplitEngine {
+    // route started at a position k < p and open at p: its release date (with the label of k) and its time from the
+    // depot to the client p-1
+    struct Head {
+        unsigned int rd, time;
+    };
+
+    // the clients p.. after an open route that arrives at the client p at 'time' with the release date 'rd' (without
+    // the one of p) are completed at best at max(rd + time + a, time + b, c)
+    struct Tail {
+        unsigned int a, b, c;
+    };
+
+    const DistanceMatrix &W;
+    const vector<unsigned int> &RD;
+    const bool stopRoutes; // the routes stop growing once they cannot improve the label
+    vector<unsigned int> S; // sequence of the last call
+    vector<unsigned int> bestIn, delta;
+    vector<unsigned int> trial; // labels of the sequences given to evaluate
+    unsigned int bound = 0; // completion time of the last split, the heads and tails that cannot end before are dropped
+    unsigned int minFromDepot = 0; // shortest arc from the depot, so the least time of a route
+    // cheapest arc arriving at each vertex (computed at the first evaluation), and their sum over the clients and the
+    // depot: the least time of the routes after a head of the position p is minInTotal - minInBefore[p]
+    vector<unsigned int> minIn, minInBefore;
+    unsigned int minInTotal = 0;
+    // heads of the position p: headData[headBegin[p]..headBegin[p + 1]), valid for the positions up to headsBuilt
+    vector<Head> headData;
+    vector<unsigned int> headBegin;
+    unsigned int headsBuilt = 0;
+    // tails of the position p: tailData[tailBegin[p]..tailEnd[p]), valid for the positions from tailsBuilt
+    vector<Tail> tailData;
+    vector<unsigned int> tailBegin, tailEnd;
+    unsigned int tailsBuilt = 0;
+    unsigned long long labels = 0, reusedLabels = 0;
+
+    // label of the position j of the sequence s, given the labels 'lab' of the route starts low..j-1
+    unsigned int label(const unsigned int *s, const unsigned int *lab, unsigned int j, unsigned int low,
+                       unsigned int &bestI) const {
+        const unsigned int *fromDepot = W.fromDepot();
+        // routes with the clients i..j-1, from the shortest to the longest
+        // release date and time of the route, without the arc from the depot
+        unsigned int bigger = RD[s[j - 1]], sumTimes = W[s[j - 1]][0];
+        unsigned int best = numeric_limits<unsigned int>::max();
+        for (int i = (int) j - 1; i >= (int) low; i--) {
+            if (i < (int) j - 1) {
+                bigger = max(bigger, RD[s[i]]);
+                sumTimes += W[s[i]][s[i + 1]];
+            }
+            const unsigned int route = fromDepot[s[i]] + sumTimes;
+            if (stopRoutes && bigger + route > best) break;
+            const unsigned int deltaJ = max(bigger, lab[i]) + route;
+            if (deltaJ <= best) { // the first route start on ties
+                best = deltaJ;
+                bestI = i;
+            }
+        }
+        return best;
+    }
+
+    // heads of the positions up to p, each from the heads of the previous position and the route that starts there
+    void buildHeads(unsigned int p) {
+        const unsigned int *fromDepot = W.fromDepot();
+        if (minIn.empty()) {
+            minIn.assign(W.size(), numeric_limits<unsigned int>::max());
+            for (unsigned int u = 0; u < W.size(); u++) {
+                const auto row = W[u];
+                for (unsigned int v = 0; v < W.size(); v++) {
+                    if (u != v) minIn[v] = min(minIn[v], row[v]);
                 }
-                routesRD[i][j] = bigger;
+            }
+            sumMinIn();
+        }
+        headData.resize(headBegin[headsBuilt + 1]);
+        for (unsigned int q = headsBuilt + 1; q <= p; q++) {
+            const unsigned int x = S[q - 1], first = headBegin[q - 1], last = headBegin[q];
+            minInBefore[q] = minInBefore[q - 1] + minIn[x];
+            const unsigned int rest = minInTotal - minInBefore[q];
+            for (unsigned int h = first; h < last; h++) {
+                const Head head = {max(headData[h].rd, RD[x]), headData[h].time + W[S[q - 2]][x]};
+                if (head.rd + head.time + rest < bound) headData.push_back(head);
+            }
+            const Head start = {max(RD[x], delta[q - 1]), fromDepot[x]};
+            if (start.rd + start.time + rest < bound) headData.push_back(start);
 
-                sumTimes += W[S[j - 1]][S[j]];
-                routesTime[i][j] = sumTimes + W[S[j]][0];
+            // pareto filter on (rd + time, time), which give the completion of the head (see Tail): by increasing
+            // rd + time, the times must decrease
+            sort(headData.begin() + last, headData.end(), [](const Head &h1, const Head &h2) {
+                return h1.rd + h1.time < h2.rd + h2.time || (h1.rd + h1.time == h2.rd + h2.time && h1.time < h2.time);
+            });
+            unsigned int kept = last;
+            for (unsigned int h = last; h < headData.size(); h++) {
+                if (kept == last || headData[h].time < headData[kept - 1].time) headData[kept++] = headData[h];
             }
+            headData.resize(kept);
+            headBegin[q + 1] = kept;
         }
+        headsBuilt = max(headsBuilt, p);
+    }
 
-        vector<unsigned int> bestIn(N + 1); // store the origin of the best arc arriving at i
-        vector<unsigned int> delta(N + 1, numeric_limits<unsigned int>::max()); // value of the best arc arriving at i
-        delta[0] = 0;
+    // minIn of the depot and of the clients of S
+    void sumMinIn() {
+        minInTotal = minIn[0];
+        for (unsigned int c: S) {
+            minInTotal += minIn[c];
+        }
+    }
 
-        for (unsigned int i = 0; i < N; i++) {
-            for (unsigned int j = i + 1; j <= N; j++) {
-                unsigned int deltaJ = max(routesRD[i][j - 1], delta[i]) + routesTime[i][j - 1];
-                if (deltaJ < delta[j]) {
-                    delta[j] = deltaJ;
-                    bestIn[j] = i;
+    // keeps the tail if it can end before the last split
+    void addTail(const Tail &tail) {
+        if (max(minFromDepot + tail.b, tail.c) < bound) tailData.push_back(tail);
+    }
+
+    // tails of the positions from p, each from the tails of the next position: the route goes on to the next client or
+    // ends at p, then the next route starts
+    void buildTails(unsigned int p) {
+        const unsigned int N = S.size();
+        const unsigned int *fromDepot = W.fromDepot();
+        tailData.resize(tailsBuilt < N ? tailEnd[tailsBuilt] : 0);
+        for (int q = (int) tailsBuilt - 1; q >= (int) p; q--) {
+            const unsigned int x = S[q], back = W[x][0], first = tailData.size();
+            if (q == (int) N - 1) {
+                addTail({back, RD[x] + back, 0});
+            } else {
+                const unsigned int next = S[q + 1], arc = W[x][next], restart = back + fromDepot[next];
+                for (unsigned int t = tailBegin[q + 1]; t < tailEnd[q + 1]; t++) {
+                    const Tail tail = tailData[t];
+                    addTail({arc + tail.a, max(RD[x] + arc + tail.a, arc + tail.b), tail.c});
+                    addTail({restart + tail.a, RD[x] + restart + tail.a, max(fromDepot[next] + tail.b, tail.c)});
                 }
             }
+
+            // pareto filter: by increasing a, a tail is kept if no tail kept before has both a lower b and c
+            sort(tailData.begin() + first, tailData.end(), [](const Tail &t1, const Tail &t2) {
+                return t1.a < t2.a || (t1.a == t2.a && (t1.b < t2.b || (t1.b == t2.b && t1.c < t2.c)));
+            });
+            unsigned int kept = first;
+            for (unsigned int t = first; t < tailData.size(); t++) {
+                bool dominated = false;
+                for (unsigned int k = first; k < kept && !dominated; k++) {
+                    dominated = tailData[k].b <= tailData[t].b && tailData[k].c <= tailData[t].c;
+                }
+                if (!dominated) tailData[kept++] = tailData[t];
+            }
+            tailData.resize(kept);
+            tailBegin[q] = first;
+            tailEnd[q] = kept;
+        }
+        tailsBuilt = min(tailsBuilt, p);
+    }
+
+public:
+    SplitEngine(const DistanceMatrix &W, const vector<unsigned int> &RD, bool depotTriangular)
+            : W(W), RD(RD), stopRoutes(depotTriangular) {}
+
+    unsigned int split(const vector<unsigned int> &sequence, vector<unsigned int> &ends) {
+        const unsigned int N = sequence.size();
+        const bool sameSize = S.size() == N;
+        unsigned int p = 0; // first position that changed
+        while (p < N && p < S.size() && S[p] == sequence[p]) p++;
+        unsigned int q = N; // the positions q.. did not change
+        while (sameSize && q > p && S[q - 1] == sequence[q - 1]) q--;
+        S = sequence;
+        bestIn.resize(N + 1);
+        delta.resize(N + 1);
+        delta[0] = 0;
+        labels += N;
+        reusedLabels += p;
+
+        for (unsigned int j = p + 1; j <= N; j++) {
+            delta[j] = label(S.data(), delta.data(), j, 0, bestIn[j]);
+        }
+
+        ends.clear();
+        for (unsigned int x = N; x > 0; x = bestIn[x]) {
+            ends.push_back(x - 1);
+        }
+        reverse(ends.begin(), ends.end());
+
+        // the heads before p and the tails from q are kept, unless they were filtered by a lower bound
+        if (!sameSize || delta[N] > bound) {
+            headBegin.assign(N + 2, 0);
+            minInBefore.assign(N + 1, 0);
+            tailBegin.resize(N);
+            tailEnd.resize(N);
+            headsBuilt = 0;
+            tailsBuilt = N;
+        } else {
+            headsBuilt = min(headsBuilt, p);
+            tailsBuilt = max(tailsBuilt, q);
+        }
+        bound = delta[N];
+        const unsigned int *fromDepot = W.fromDepot();
+        minFromDepot = numeric_limits<unsigned int>::max();
+        for (unsigned int c: S) {
+            minFromDepot = min(minFromDepot, fromDepot[c]);
+        }
+        if (!minIn.empty()) sumMinIn();
+
+        return delta[N];
+    }
+
+    /*
+     * completion time of the best split of 'sequence', which differs from the last split sequence only in the
+     * positions from..to-1, if it is lower than the one of the last split (otherwise returns the latter)
+     *
+     * the labels up to 'from' are the ones of the last sequence, the next ones up to 'to' also take the routes of the
+     * heads of 'from'; then the route over the client 'to' started in a head, in from..to or at 'to', and is completed
+     * by the tails of 'to'
+     * so an evaluation costs O((to - from) * (to - from + heads) + (to - from + heads) * tails), and the tables are
+     * only built again for the positions changed by the moves applied
+     */
+    unsigned int evaluate(const vector<unsigned int> &sequence, unsigned int from, unsigned int to) {
+        const unsigned int N = sequence.size();
+        const unsigned int *s = sequence.data();
+        const unsigned int *fromDepot = W.fromDepot();
+        buildHeads(from);
+        if (to < N) buildTails(to);
+        trial.resize(N + 1);
+        trial[from] = delta[from];
+        labels += N;
+        reusedLabels += N - (to - from);
+
+        // the heads go on with the clients from..j-1, which add their release date and time from the client from-1
+        const unsigned int firstHead = headBegin[from], lastHead = headBegin[from + 1];
+        unsigned int bigger = 0, sumTimes = firstHead < lastHead ? W[s[from - 1]][s[from]] : 0;
+        unsigned int bestI;
+        for (unsigned int j = from + 1; j <= to; j++) {
+            if (j - 1 > from) sumTimes += W[s[j - 2]][s[j - 1]];
+            bigger = max(bigger, RD[s[j - 1]]);
+            unsigned int best = label(s, trial.data(), j, from, bestI);
+            for (unsigned int h = firstHead; h < lastHead; h++) {
+                best = min(best, max(headData[h].rd, bigger) + headData[h].time + sumTimes + W[s[j - 1]][0]);
+            }
+            trial[j] = best;
         }
+        unsigned int best = delta[N];
+        if (to == N) return min(trial[N], best);
 
-        unsigned int x = bestIn[N];
-        while (x > 0) {
-            visits.insert(S[x - 1]);
-            x = bestIn[x];
+        // the route that arrives at the client 'to' with the release date rd and the time 'time', then the tails
+        const unsigned int firstTail = tailBegin[to], lastTail = tailEnd[to];
+        auto complete = [&](unsigned int rd, unsigned int time) {
+            if (rd + time >= best) return;
+            for (unsigned int t = firstTail; t < lastTail; t++) {
+                const Tail &tail = tailData[t];
+                best = min(best, max(max(rd + time + tail.a, time + tail.b), tail.c));
+            }
+        };
+        const unsigned int arc = W[s[to - 1]][s[to]];
+        for (unsigned int h = firstHead; h < lastHead; h++) {
+            complete(max(headData[h].rd, bigger), headData[h].time + sumTimes + arc);
+        }
+        bigger = 0;
+        sumTimes = arc;
+        for (int i = (int) to - 1; i >= (int) from; i--) {
+            if (i < (int) to - 1) sumTimes += W[s[i]][s[i + 1]];
+            bigger = max(bigger, RD[s[i]]);
+            complete(max(bigger, trial[i]), fromDepot[s[i]] + sumTimes);
         }
+        complete(trial[to], fromDepot[s[to]]);
+        return best;
+    }
 
-        return delta.back();
+    // share of the labels that were kept from the previous sequences
+    double reuseRate() const {
+        return labels == 0 ? 0 : (double) reusedLabels / labels;
     }
 };
 
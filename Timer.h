@@ -1,6 +1,11 @@
 #ifndef TSPRD_TIMER_H
 #define TSPRD_TIMER_H
 
+#include <chrono>
+#include <stdexcept>
+
+using namespace std;
+
 template<class TimeT = std::chrono::milliseconds,
         class ClockT = std::chrono::steady_clock>
 class Timer {
@@ -6,6 +6,8 @@
 #include "Grasp.h"
 #include "RoutePool.h"
 #include "MathModelRoutes.h"
+#include "Random.h"
+#include "Budget.h"
 
 using namespace std;
 
@@ -24,14 +26,66 @@ int main(int argc, char **argv) {
     double alpha = 0.2;
 
     auto timeLimit = (unsigned int) (10 * 60 * (1976.0 / 1201.0)); // in seconds
+    Budget budget; // no machine independent limit by default
+    SearchOptions searchOptions;
+    Crossover::Type crossover = Crossover::ORDER;
+    bool relabel = false;
+
+    // positional arguments: instance [output folder] [execution id]
+    // optional arguments:
+    //   --seed <seed>              the same seed (and budget) reproduces the same search
+    //   --timeLimit <seconds>
+    //   --maxOffspring <n>         stop after n offspring
+    //   --maxEvaluations <n>       stop after n move evaluations in the neighbor search
+    //   --maxSplits <n>            stop after n calls to the split algorithm
+    //   --segmentOperators <0|1>   use orOpt, twoOptStar and segmentSwap in the inter route search
+    //   --interPolicy <best|first> improvement policy of the segment operators
+    //   --adaptiveOrder <0|1>      order the operators by their observed gain per cost
+    //   --timeCost <0|1>           measure the cost of the operators in time instead of move evaluations
+    //   --crossover <ox|cox|eax>   order crossover, cyclic order crossover or edge assembly crossover
+    //   --giantTour <0|1>          educate with relocate, swap and 2-opt moves on the giant tour instead of the split
+    //   --relabel <0|1>            renumber the clients for the memory locality of W (the output keeps the file ids)
+    vector<string> args;
+    unsigned int seed = Random::randomSeed();
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) {
+            seed = stoul(argv[++i]);
+        } else if (arg == "--timeLimit" && i + 1 < argc) {
+            timeLimit = stoul(argv[++i]);
+        } else if (arg == "--maxOffspring" && i + 1 < argc) {
+            budget.maxOffspring = stoull(argv[++i]);
+        } else if (arg == "--maxEvaluations" && i + 1 < argc) {
+            budget.maxEvaluations = stoull(argv[++i]);
+        } else if (arg == "--maxSplits" && i + 1 < argc) {
+            budget.maxSplits = stoull(argv[++i]);
+        } else if (arg == "--segmentOperators" && i + 1 < argc) {
+            searchOptions.segmentOperators = stoi(argv[++i]) != 0;
+        } else if (arg == "--interPolicy" && i + 1 < argc) {
+            searchOptions.bestImprovement = string(argv[++i]) == "best";
+        } else if (arg == "--adaptiveOrder" && i + 1 < argc) {
+            searchOptions.adaptiveOrder = stoi(argv[++i]) != 0;
+        } else if (arg == "--timeCost" && i + 1 < argc) {
+            searchOptions.timeCost = stoi(argv[++i]) != 0;
+        } else if (arg == "--relabel" && i + 1 < argc) {
+            relabel = stoi(argv[++i]) != 0;
+        } else if (arg == "--giantTour" && i + 1 < argc) {
+            searchOptions.giantTourSearch = stoi(argv[++i]) != 0;
+        } else if (arg == "--crossover" && i + 1 < argc) {
+            crossover = Crossover::fromName(argv[++i]);
+        } else {
+            args.push_back(arg);
+        }
+    }
 
-    string instanceFile = argv[1];
-    Instance instance(instanceFile);
+    string instanceFile = args[0];
+    Instance instance(instanceFile, relabel);
 
     RoutePool routePool(10000, instance.nClients());
 
-    auto alg = GeneticAlgorithm(instance, mi, lambda, nClose, nbElite, itNi, itDiv, timeLimit, routePool);
-//    auto alg = Grasp(instance, itNiGrasp, alpha, timeLimit);
+    auto alg = GeneticAlgorithm(instance, mi, lambda, nClose, nbElite, itNi, itDiv, timeLimit, budget, routePool,
+                                seed, searchOptions, crossover);
+//    auto alg = Grasp(instance, itNiGrasp, alpha, timeLimit, budget, seed, searchOptions);
     Solution s = alg.getSolution();
     s.validate();
 
@@ -54,6 +108,25 @@ int main(int argc, char **argv) {
     cout << "\tRESULT \t" << s.time << endl;
     cout << "\tEXEC_TIME \t" << alg.getExecutionTime() << endl;
     cout << "\tSOL_TIME \t" << alg.getBestSolutionTime() << endl;
+    cout << "\tSEED \t" << seed << endl;
+    // the gap is 0 when the search stopped on a solution proved optimal
+    cout << "\tLOWER_BOUND \t" << alg.getLowerBound() << endl;
+    cout << "\tGAP \t" << (double) (s.time - alg.getLowerBound()) / s.time << endl;
+
+    // throughput of the search, comparable between machines and versions
+    const double execSeconds = max(alg.getExecutionTime(), 1u) / 1000.0;
+    cout << "\tOFFSPRING \t" << alg.getOffspring() << endl;
+    cout << "\tEVALUATIONS \t" << alg.getEvaluations() << endl;
+    cout << "\tSPLITS \t" << alg.getSplits() << endl;
+    cout << "\tDUPLICATES \t" << alg.getDuplicates() << endl;
+    cout << "\tCACHE_HIT_RATE \t" << alg.getEducationCache().hitRate() << endl;
+    cout << "\tOFFSPRING_PER_SEC \t" << (unsigned long long) (alg.getOffspring() / execSeconds) << endl;
+    cout << "\tEVALUATIONS_PER_SEC \t" << (unsigned long long) (alg.getEvaluations() / execSeconds) << endl;
+    if (searchOptions.adaptiveOrder) {
+        for (auto &weight: alg.getNeighborSearch().getOperatorWeights()) {
+            cout << "\tWEIGHT_" << weight.first << " \t" << weight.second << endl;
+        }
+    }
 
     cout << "\tRESULT_MODEL \t" << sModel.time << endl;
     cout << "\tEXEC_TIME_MODEL \t" << model.getTime() << endl;
@@ -64,11 +137,11 @@ int main(int argc, char **argv) {
     unsigned long long timeStamp = std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::system_clock::now().time_since_epoch()).count();
     string outFile = to_string(timeStamp) + "/" + instanceFile;
-    if (argc > 2)
-        outFile = string(argv[2]) + "/" + instanceFile;
+    if (args.size() > 1)
+        outFile = args[1] + "/" + instanceFile;
     string id = "1";
-    if (argc > 3)
-        id = string(argv[3]);
+    if (args.size() > 2)
+        id = args[2];
     outFile = "output/" + outFile + "_" + id + ".txt";
     string dir = outFile.substr(0, outFile.find_last_of('/'));
     system(("mkdir -p " + dir).c_str());
@@ -76,14 +149,19 @@ int main(int argc, char **argv) {
     ofstream fout(outFile, ios::out);
     fout << "EXEC_TIME " << alg.getExecutionTime() << endl;
     fout << "SOL_TIME " << alg.getBestSolutionTime() << endl;
-    fout << "OBJ " << s.time << endl;
+    fout << "OBJ " << s.time << endl; // the result processor reads the first three values by position
+    fout << "SEED " << seed << endl;
+    fout << "LOWER_BOUND " << alg.getLowerBound() << endl;
+    fout << "OFFSPRING " << alg.getOffspring() << endl;
+    fout << "EVALUATIONS " << alg.getEvaluations() << endl;
+    fout << "SPLITS " << alg.getSplits() << endl;
     fout << "N_ROUTES " << s.routes.size() << endl;
     fout << "N_CLIENTS";
     for (auto &r: s.routes) fout << " " << (r->size() - 2);
     fout << endl << "ROUTES" << endl;
     for (auto &r: s.routes) {
         for (unsigned int c = 1; c < r->size() - 1; c++) {
-            fout << r->at(c) << " ";
+            fout << instance.originalId(r->at(c)) << " ";
         }
         fout << endl;
     }
@@ -98,7 +176,7 @@ int main(int argc, char **argv) {
     fout << endl << "ROUTES" << endl;
     for (auto &r: sModel.routes) {
         for (unsigned int c = 1; c < r->size() - 1; c++) {
-            fout << r->at(c) << " ";
+            fout << instance.originalId(r->at(c)) << " ";
         }
         fout << endl;
     }
@@ -112,5 +190,13 @@ int main(int argc, char **argv) {
         spout << x.first << "\t" << x.second << endl;
     }
     spout.close();
+
+#ifdef TSPRD_PROFILE
+    // output the neighbor search operators statistics
+    string profFile = outFile.substr(0, outFile.find_last_of('.')) + "_PROF.txt";
+    ofstream profout(profFile, ios::out);
+    alg.getNeighborSearch().printStats(profout);
+    profout.close();
+#endif
     return 0;
 }
\ No newline at end of file